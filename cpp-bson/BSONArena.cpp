@@ -0,0 +1,407 @@
+#include "BSONArena.hpp"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+// Implementation of BSONArena
+
+BSONArena::BSONArena(size_t blockSize) : blockSize(blockSize) {}
+
+// The blocks change owner, so the source must forget its cursor into them.
+BSONArena::BSONArena(BSONArena&& other) noexcept
+    : blocks(std::move(other.blocks)), cursor(other.cursor), limit(other.limit), blockSize(other.blockSize),
+      reserved(other.reserved) {
+    other.blocks.clear();
+    other.cursor = other.limit = nullptr;
+    other.reserved = 0;
+}
+
+BSONArena& BSONArena::operator=(BSONArena&& other) noexcept {
+    if (this != &other) {
+        blocks = std::move(other.blocks);
+        cursor = other.cursor;
+        limit = other.limit;
+        blockSize = other.blockSize;
+        reserved = other.reserved;
+        other.blocks.clear();
+        other.cursor = other.limit = nullptr;
+        other.reserved = 0;
+    }
+    return *this;
+}
+
+// allocate
+// Bumps the cursor of the current block, starting a new block when the
+// request does not fit. Oversized requests get a block of their own.
+void* BSONArena::allocate(size_t size, size_t align) {
+    uintptr_t p = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t)(align - 1);
+    if (cursor == nullptr || p + size > reinterpret_cast<uintptr_t>(limit)) {
+        size_t length = std::max(blockSize, size + align);
+        blocks.emplace_back(new char[length]);
+        reserved += length;
+        cursor = blocks.back().get();
+        limit = cursor + length;
+        p = (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    cursor = reinterpret_cast<char*>(p + size);
+    return reinterpret_cast<void*>(p);
+}
+
+void BSONArena::reset() {
+    if (blocks.size() > 1) {
+        blocks.clear();
+        blocks.emplace_back(new char[reserved]);
+        limit = blocks[0].get() + reserved;
+    }
+    cursor = blocks.empty() ? nullptr : blocks[0].get();
+}
+
+std::string_view BSONArena::copyString(std::string_view s) {
+    if (s.empty()) return {};
+    char* data = static_cast<char*>(allocate(s.size(), 1));
+    std::memcpy(data, s.data(), s.size());
+    return {data, s.size()};
+}
+
+// Implementation of the arena document types
+
+BSONValue ArenaValue::toBSONValue() const {
+    switch (type) {
+        case BSONValue::STRING: return BSONValue(std::string(asString()));
+        case BSONValue::INT: return BSONValue(intValue);
+        case BSONValue::FLOAT: return BSONValue(floatValue);
+        case BSONValue::BOOL: return BSONValue(boolValue);
+        case BSONValue::ARRAY: {
+            BSONArray arr;
+            arr.reserve(array.size);
+            for (size_t i = 0; i < array.size; i++) arr.push_back(at(i).toBSONValue());
+            return BSONValue(std::move(arr));
+        }
+        case BSONValue::OBJECT: return BSONValue(std::make_shared<BSONMap>(map->toBSONMap()));
+        default: return BSONValue();
+    }
+}
+
+ArenaValue ArenaValue::at(size_t index) const {
+    ArenaValue value;
+    switch (layout) {
+        case ARENA_ARRAY_VALUES: return array.items[index];
+        case ARENA_ARRAY_INTS:
+            value.type = BSONValue::INT;
+            value.intValue = array.ints[index];
+            break;
+        case ARENA_ARRAY_FLOATS:
+            value.type = BSONValue::FLOAT;
+            value.floatValue = array.floats[index];
+            break;
+        case ARENA_ARRAY_STRINGS: {
+            std::string_view s = stringAt(index);
+            value.type = BSONValue::STRING;
+            value.string = {s.data(), s.size()};
+            break;
+        }
+    }
+    return value;
+}
+
+const ArenaValue* ArenaMap::find(std::string_view key) const {
+    return find(key, slots ? std::hash<std::string_view>()(key) : 0);
+}
+
+const ArenaValue* ArenaMap::find(std::string_view key, size_t hash) const {
+    if (slots) {
+        // Linear probing; the table is at most half full, so a probe always
+        // ends at an empty slot
+        for (size_t i = hash & slotMask; slots[i] != 0; i = (i + 1) & slotMask) {
+            const ArenaMember& m = members[slots[i] - 1];
+            if (m.key == key) return &m.value;
+        }
+        return nullptr;
+    }
+    const ArenaMember* it = std::lower_bound(begin(), end(), key, [](const ArenaMember& m, std::string_view k) {
+        return m.key < k;
+    });
+    if (it == end() || it->key != key) return nullptr;
+    return &it->value;
+}
+
+const ArenaValue* ArenaMap::find(BSONKey key) const {
+    // Interned keys are unique, so the same key means the same address
+    if (!key) return nullptr;
+    if (size > 8) return find(key.str());
+    for (const ArenaMember& m : *this) {
+        if (m.key.data() == key.str().data()) return &m.value;
+    }
+    return nullptr;
+}
+
+BSONMap ArenaMap::toBSONMap() const {
+    BSONMap result;
+    for (const ArenaMember& m : *this) {
+        result.emplace_hint(result.end(), std::string(m.key), m.value.toBSONValue());
+    }
+    return result;
+}
+
+ArenaDocument::ArenaDocument() : rootMap(storage.allocateArray<ArenaMap>(1)) {
+    *rootMap = ArenaMap{};
+}
+
+void ArenaDocument::reset() {
+    storage.reset();
+    rootMap = storage.allocateArray<ArenaMap>(1);
+    *rootMap = ArenaMap{};
+}
+
+// parseArena
+// Same grammar as parse(), but every node lands in one ArenaDocument.
+ArenaDocument BSONParser::parseArena(std::string_view content) {
+    return parseArena(content, ArenaOptions());
+}
+
+ArenaDocument BSONParser::parseArena(std::string_view content, const ArenaOptions& options) {
+    ArenaDocument document;
+    ArenaBuilder builder(document, options, interner != nullptr);
+    parse(content, builder);
+    builder.finish();
+    return document;
+}
+
+// Implementation of ArenaBuilder
+
+ArenaBuilder::ArenaBuilder(ArenaDocument& document, const ArenaOptions& options, bool internedKeys)
+    : document(document), options(options), internedKeys(internedKeys) {
+    members.emplace_back();
+    maps.push_back(document.rootMap);
+}
+
+bool ArenaBuilder::onSectionOpen(std::string_view key, int /*level*/) {
+    // The section node is allocated now so the parent can point at it;
+    // its members are filled in when the section closes.
+    ArenaMap* map = document.storage.allocateArray<ArenaMap>(1);
+    *map = ArenaMap{};
+
+    ArenaValue value;
+    value.type = BSONValue::OBJECT;
+    value.map = map;
+    members[depth].push_back({storeKey(key), value});
+
+    depth++;
+    if (members.size() <= depth) members.emplace_back();
+    else members[depth].clear();
+    maps.resize(depth + 1);
+    maps[depth] = map;
+    return true;
+}
+
+bool ArenaBuilder::onSectionClose(int /*level*/) {
+    commit(*maps[depth], members[depth]);
+    depth--;
+    return true;
+}
+
+bool ArenaBuilder::onKey(std::string_view key) {
+    pendingKey = storeKey(key);
+    return true;
+}
+
+bool ArenaBuilder::onValue(const TokenView& token) {
+    ArenaValue value;
+    switch (token.type) {
+        case TOKEN_STRING: {
+            // Array elements are copied by commitArray
+            std::string_view s = arrayDepth > 0 ? token.literal : document.storage.copyString(token.literal);
+            value.type = BSONValue::STRING;
+            value.string = {s.data(), s.size()};
+            break;
+        }
+        case TOKEN_NUMBER: {
+            value.type = token.isFloat ? BSONValue::FLOAT : BSONValue::INT;
+            if (token.isFloat) value.floatValue = token.floatValue;
+            else value.intValue = token.intValue;
+            break;
+        }
+        case TOKEN_BOOL:
+            value.type = BSONValue::BOOL;
+            value.boolValue = token.literal == "true";
+            break;
+        default:
+            value.type = BSONValue::NULL_TYPE;
+            value.map = nullptr;
+            break;
+    }
+    store(value);
+    return true;
+}
+
+bool ArenaBuilder::onArrayStart() {
+    if (arrays.size() <= arrayDepth) arrays.emplace_back();
+    else arrays[arrayDepth].clear();
+    arrayDepth++;
+    return true;
+}
+
+bool ArenaBuilder::onArrayEnd() {
+    ArenaValue value = commitArray(arrays[--arrayDepth]);
+    store(value);
+    return true;
+}
+
+void ArenaBuilder::finish() {
+    commit(*maps[0], members[0]);
+}
+
+void ArenaBuilder::reset() {
+    members[0].clear();
+    maps.resize(1);
+    maps[0] = document.rootMap;
+    depth = 0;
+    arrayDepth = 0;
+    pendingKey = {};
+}
+
+std::string_view ArenaBuilder::storeKey(std::string_view key) {
+    return internedKeys ? key : document.storage.copyString(key);
+}
+
+// store
+// Places a finished value into the enclosing array, or under the pending key.
+void ArenaBuilder::store(const ArenaValue& value) {
+    if (arrayDepth > 0) {
+        arrays[arrayDepth - 1].push_back(value);
+        return;
+    }
+    members[depth].push_back({pendingKey, value});
+}
+
+// commitArray
+// Moves a closed array's elements into the arena, packed if they share one
+// type of int, float or string.
+ArenaValue ArenaBuilder::commitArray(std::vector<ArenaValue>& scratch) {
+    size_t n = scratch.size();
+    BSONValue::Type shared = n > 0 ? scratch[0].type : BSONValue::NULL_TYPE;
+    size_t bytes = 0;
+    for (const ArenaValue& item : scratch) {
+        if (item.type != shared) shared = BSONValue::NULL_TYPE;
+        if (item.type == BSONValue::STRING) bytes += item.string.size;
+    }
+    if (!options.typedArrays || (shared == BSONValue::STRING && bytes > UINT32_MAX)) shared = BSONValue::NULL_TYPE;
+
+    ArenaValue value;
+    value.type = BSONValue::ARRAY;
+    value.array.size = n;
+    BSONArena& arena = document.storage;
+    switch (shared) {
+        case BSONValue::INT: {
+            int* ints = static_cast<int*>(arena.allocate(n * sizeof(int)));
+            for (size_t i = 0; i < n; i++) ints[i] = scratch[i].intValue;
+            value.layout = ARENA_ARRAY_INTS;
+            value.array.ints = ints;
+            break;
+        }
+        case BSONValue::FLOAT: {
+            double* floats = static_cast<double*>(arena.allocate(n * sizeof(double)));
+            for (size_t i = 0; i < n; i++) floats[i] = scratch[i].floatValue;
+            value.layout = ARENA_ARRAY_FLOATS;
+            value.array.floats = floats;
+            break;
+        }
+        case BSONValue::STRING: {
+            uint32_t* offsets = static_cast<uint32_t*>(arena.allocate((n + 1) * sizeof(uint32_t) + bytes, alignof(uint32_t)));
+            char* data = reinterpret_cast<char*>(offsets + n + 1);
+            uint32_t offset = 0;
+            for (size_t i = 0; i < n; i++) {
+                offsets[i] = offset;
+                if (scratch[i].string.size) std::memcpy(data + offset, scratch[i].string.data, scratch[i].string.size);
+                offset += static_cast<uint32_t>(scratch[i].string.size);
+            }
+            offsets[n] = offset;
+            value.layout = ARENA_ARRAY_STRINGS;
+            value.array.offsets = offsets;
+            break;
+        }
+        default: {
+            ArenaValue* items = arena.allocateArray<ArenaValue>(n);
+            for (size_t i = 0; i < n; i++) {
+                items[i] = scratch[i];
+                if (items[i].type == BSONValue::STRING) {
+                    std::string_view s = arena.copyString(items[i].asString());
+                    items[i].string = {s.data(), s.size()};
+                }
+            }
+            value.array.items = items;
+            break;
+        }
+    }
+    return value;
+}
+
+// commit
+// Sorts a section's members by key, keeps the last of each duplicate
+// (matching BSONMap's assignment semantics) and copies the run into the arena.
+void ArenaBuilder::commit(ArenaMap& map, std::vector<ArenaMember>& scratch) {
+    sortMembers(scratch);
+
+    ArenaMember* out = document.storage.allocateArray<ArenaMember>(scratch.size());
+    size_t n = 0;
+    for (size_t i = 0; i < scratch.size(); i++) {
+        if (i + 1 < scratch.size() && scratch[i + 1].key == scratch[i].key) continue;
+        out[n++] = scratch[i];
+    }
+    map.members = out;
+    map.size = n;
+    if (options.hashThreshold != 0 && n >= options.hashThreshold) buildIndex(map);
+}
+
+// sortMembers
+// Stable sort by key. std::stable_sort would allocate a merge buffer on
+// every call; this one insertion-sorts runs of 32 members in place, then
+// merges them pairwise through a buffer the builder keeps between parses.
+void ArenaBuilder::sortMembers(std::vector<ArenaMember>& scratch) {
+    static const size_t kRun = 32;
+    auto byKey = [](const ArenaMember& a, const ArenaMember& b) { return a.key < b.key; };
+    size_t n = scratch.size();
+    for (size_t start = 0; start < n; start += kRun) {
+        size_t end = std::min(n, start + kRun);
+        for (size_t i = start + 1; i < end; i++) {
+            ArenaMember m = scratch[i];
+            size_t j = i;
+            for (; j > start && byKey(m, scratch[j - 1]); j--) scratch[j] = scratch[j - 1];
+            scratch[j] = m;
+        }
+    }
+    if (n <= kRun) return;
+
+    mergeBuffer.resize(n);
+    ArenaMember* from = scratch.data();
+    ArenaMember* to = mergeBuffer.data();
+    for (size_t width = kRun; width < n; width *= 2) {
+        for (size_t start = 0; start < n; start += 2 * width) {
+            size_t mid = std::min(n, start + width);
+            size_t end = std::min(n, start + 2 * width);
+            std::merge(from + start, from + mid, from + mid, from + end, to + start, byKey);
+        }
+        std::swap(from, to);
+    }
+    if (from != scratch.data()) std::copy(from, from + n, scratch.data());
+}
+
+// buildIndex
+// Open-addressing table with at least twice as many slots as members.
+// Slots hold positions into the sorted members, so the index costs four
+// bytes per slot and iteration order is unaffected.
+void ArenaBuilder::buildIndex(ArenaMap& map) {
+    size_t slotCount = 1;
+    while (slotCount < map.size * 2) slotCount <<= 1;
+    uint32_t* slots = document.storage.allocateArray<uint32_t>(slotCount);
+    std::fill(slots, slots + slotCount, 0u);
+
+    size_t mask = slotCount - 1;
+    for (size_t m = 0; m < map.size; m++) {
+        size_t i = std::hash<std::string_view>()(map.members[m].key) & mask;
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = static_cast<uint32_t>(m + 1);
+    }
+    map.slots = slots;
+    map.slotMask = mask;
+}
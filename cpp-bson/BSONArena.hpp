@@ -0,0 +1,228 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "BSONParser.hpp"
+
+// BSONArena Class
+// Bump allocator that hands out memory from large blocks.
+// Nothing is freed individually: all memory goes back when the arena is
+// destroyed, so tearing down a document costs one free per block instead of
+// one per node. Only trivially destructible objects may live in it.
+class BSONArena {
+public:
+    explicit BSONArena(size_t blockSize = 64 * 1024);
+    BSONArena(BSONArena&& other) noexcept;
+    BSONArena& operator=(BSONArena&& other) noexcept;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    // Uninitialized storage for n objects of a trivially destructible type
+    template <typename T>
+    T* allocateArray(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Copies the bytes of s into the arena and returns a view of the copy
+    std::string_view copyString(std::string_view s);
+
+    // Frees everything allocated so far at once and keeps the memory for
+    // what comes next. If it had grown past one block, the blocks are
+    // replaced by a single one as large as all of them together.
+    void reset();
+
+    size_t blockCount() const { return blocks.size(); }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t blockSize;
+    size_t reserved = 0; // Bytes in all blocks
+};
+
+struct ArenaMap;
+
+// ArenaArrayLayout Enum
+// How the elements of an arena array are stored. Arrays whose elements all
+// are ints, all floats or all strings are packed (see ArenaOptions):
+// contiguous int / double storage, or a string table of size + 1 offsets
+// followed by all the bytes. Anything else is one ArenaValue per element.
+enum ArenaArrayLayout : uint8_t {
+    ARENA_ARRAY_VALUES,
+    ARENA_ARRAY_INTS,
+    ARENA_ARRAY_FLOATS,
+    ARENA_ARRAY_STRINGS
+};
+
+// ArenaValue Structure
+// Arena counterpart of BSONValue: a type tag plus an inline payload.
+// Strings, arrays and sections point at storage owned by the same arena.
+struct ArenaValue {
+    struct StringPayload { const char* data; size_t size; };
+    struct ArrayPayload {
+        union {
+            const ArenaValue* items; // ARENA_ARRAY_VALUES
+            const int* ints;         // ARENA_ARRAY_INTS
+            const double* floats;    // ARENA_ARRAY_FLOATS
+            const uint32_t* offsets; // ARENA_ARRAY_STRINGS: the bytes follow
+        };
+        size_t size;
+    };
+
+    BSONValue::Type type;
+    ArenaArrayLayout layout = ARENA_ARRAY_VALUES; // ARRAY only
+    union {
+        int intValue;
+        double floatValue;
+        bool boolValue;
+        StringPayload string;
+        ArrayPayload array;
+        const ArenaMap* map;
+    };
+
+    std::string_view asString() const { return {string.data, string.size}; }
+    size_t arraySize() const { return array.size; }
+    // The element at index, whatever the layout
+    ArenaValue at(size_t index) const;
+
+    // Packed arrays: the elements in contiguous storage (aligned for vector
+    // loads), or nullptr if the array has another layout
+    const int* intItems() const { return layout == ARENA_ARRAY_INTS ? array.ints : nullptr; }
+    const double* floatItems() const { return layout == ARENA_ARRAY_FLOATS ? array.floats : nullptr; }
+    // ARENA_ARRAY_STRINGS: the string at index
+    std::string_view stringAt(size_t index) const {
+        const char* bytes = reinterpret_cast<const char*>(array.offsets + array.size + 1);
+        return {bytes + array.offsets[index], array.offsets[index + 1] - array.offsets[index]};
+    }
+
+    // Deep-copies the value into the regular BSONValue representation
+    BSONValue toBSONValue() const;
+};
+
+// ArenaMember Structure
+// One key-value pair of a section.
+struct ArenaMember {
+    std::string_view key;
+    ArenaValue value;
+};
+
+// ArenaMap Structure
+// A section: its members sit next to each other in one array, sorted by key
+// like BSONMap, with duplicates already resolved (last writer wins).
+// Large sections may also carry an open-addressing hash index over the
+// members (see ArenaOptions); iteration stays in key order either way.
+struct ArenaMap {
+    const ArenaMember* members = nullptr;
+    size_t size = 0;
+    const uint32_t* slots = nullptr; // Hash index: member position + 1, 0 = empty
+    size_t slotMask = 0;             // Slot count - 1 (a power of two)
+
+    const ArenaMember* begin() const { return members; }
+    const ArenaMember* end() const { return members + size; }
+    bool indexed() const { return slots != nullptr; }
+
+    // Hash probe if indexed, otherwise binary search by key;
+    // returns nullptr if the key is absent
+    const ArenaValue* find(std::string_view key) const;
+    // Same, with the key's std::hash<std::string_view> already computed
+    const ArenaValue* find(std::string_view key, size_t hash) const;
+    // Lookup by interned key, for documents parsed with the interner that
+    // issued it: small sections are scanned comparing addresses only.
+    const ArenaValue* find(BSONKey key) const;
+
+    BSONMap toBSONMap() const;
+};
+
+// ArenaOptions Structure
+// How BSONParser::parseArena lays out sections.
+struct ArenaOptions {
+    // Sections with at least this many keys get a hash index next to their
+    // sorted members; smaller ones are only searched. 0 disables the index.
+    size_t hashThreshold = 32;
+    // Store arrays of only ints, only floats or only strings packed (see
+    // ArenaArrayLayout); false keeps one ArenaValue per element.
+    bool typedArrays = true;
+};
+
+// ArenaDocument Class
+// Result of BSONParser::parseArena. Owns the arena holding every node,
+// key and string of one parse; the views it hands out live as long as it.
+class ArenaDocument {
+public:
+    ArenaDocument();
+
+    const ArenaMap& root() const { return *rootMap; }
+    const ArenaValue* find(std::string_view key) const { return rootMap->find(key); }
+    const ArenaValue* find(BSONKey key) const { return rootMap->find(key); }
+    BSONArena& arena() { return storage; }
+
+    // Empties the document for another parse, keeping the arena's memory.
+    // Invalidates every view handed out so far. Reset the ArenaBuilder
+    // writing into the document as well.
+    void reset();
+
+private:
+    friend class ArenaBuilder;
+
+    BSONArena storage;
+    ArenaMap* rootMap;
+};
+
+// ArenaBuilder Class
+// BSONHandler that lays the event stream out in an ArenaDocument.
+// Members of the open sections and arrays are collected in scratch vectors
+// and copied into the arena as one contiguous run when they close. String
+// elements are copied when their array closes, so that a string array can
+// be packed into a single table; an array never spans lines, so its text
+// is still in the parser's buffer by then.
+// With internedKeys, keys are interned views that outlive the document and
+// are stored as they are instead of being copied into the arena.
+//
+// For high parse rates, keep one document, builder and parser and cycle
+// document.reset(), builder.reset(), parser.parse(content, builder),
+// builder.finish(): once the buffers have grown to fit the inputs, a parse
+// does not allocate at all.
+class ArenaBuilder : public BSONHandler {
+public:
+    explicit ArenaBuilder(ArenaDocument& document, const ArenaOptions& options = ArenaOptions(),
+                          bool internedKeys = false);
+
+    bool onSectionOpen(std::string_view key, int level) override;
+    bool onSectionClose(int level) override;
+    bool onKey(std::string_view key) override;
+    bool onValue(const TokenView& value) override;
+    bool onArrayStart() override;
+    bool onArrayEnd() override;
+
+    // Commits the root section; call once the parse has finished
+    void finish();
+    // Starts over on the (reset) document; the scratch vectors keep their
+    // capacity
+    void reset();
+
+private:
+    ArenaDocument& document;
+    std::vector<std::vector<ArenaMember>> members; // One per open section, root first
+    std::vector<ArenaMap*> maps;                   // Nodes of the open sections
+    std::vector<std::vector<ArenaValue>> arrays;   // One per open array; strings
+                                                   // still point into the source
+    std::vector<ArenaMember> mergeBuffer;          // Scratch of sortMembers
+    size_t depth = 0;                              // Open sections below the root
+    size_t arrayDepth = 0;
+    std::string_view pendingKey;
+    ArenaOptions options;
+    bool internedKeys;
+
+    std::string_view storeKey(std::string_view key);
+
+    void store(const ArenaValue& value);
+    ArenaValue commitArray(std::vector<ArenaValue>& scratch);
+    void commit(ArenaMap& map, std::vector<ArenaMember>& scratch);
+    void sortMembers(std::vector<ArenaMember>& scratch);
+    void buildIndex(ArenaMap& map);
+};
@@ -0,0 +1,270 @@
+#include "BSONBinary.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+using namespace BSONBinaryFormat;
+
+static const size_t kValueSize = 8;
+static const size_t kEntrySize = 4 + kValueSize;
+
+// Little-endian accessors, so blobs are portable across hosts
+static uint32_t readU32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+}
+
+static uint64_t readU64(const char* p) {
+    return uint64_t(readU32(p)) | uint64_t(readU32(p + 4)) << 32;
+}
+
+static void writeU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+static void writeU64(std::string& out, uint64_t v) {
+    writeU32(out, static_cast<uint32_t>(v));
+    writeU32(out, static_cast<uint32_t>(v >> 32));
+}
+
+// FNV-1a over the source text
+static uint64_t sourceHash(std::string_view source) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : source) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Compiler
+// Records are written children first, so every offset a record holds points
+// at something already in the blob.
+namespace {
+class BinaryCompiler {
+public:
+    std::string out;
+
+    uint32_t section(const BSONMap& map) {
+        std::string table;
+        for (const auto& entry : map) {
+            writeU32(table, key(entry.first));
+            value(table, entry.second);
+        }
+        uint32_t offset = align(4);
+        writeU32(out, static_cast<uint32_t>(map.size()));
+        out += table;
+        return offset;
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> keys;
+
+    uint32_t align(size_t alignment) {
+        while (out.size() % alignment != 0) out.push_back('\0');
+        if (out.size() > UINT32_MAX) throw std::runtime_error("Document too large to compile");
+        return static_cast<uint32_t>(out.size());
+    }
+
+    uint32_t string(std::string_view s) {
+        uint32_t offset = align(4);
+        writeU32(out, static_cast<uint32_t>(s.size()));
+        out.append(s.data(), s.size());
+        return offset;
+    }
+
+    uint32_t key(const std::string& k) {
+        auto it = keys.find(k);
+        if (it != keys.end()) return it->second;
+        uint32_t offset = string(k);
+        keys.emplace(k, offset);
+        return offset;
+    }
+
+    void value(std::string& into, const BSONValue& v) {
+        uint32_t payload = 0;
+        switch (v.type) {
+            case BSONValue::STRING: payload = string(std::get<std::string>(v.value)); break;
+            case BSONValue::INT: payload = static_cast<uint32_t>(std::get<int>(v.value)); break;
+            case BSONValue::FLOAT: {
+                double d = std::get<double>(v.value);
+                uint64_t bits;
+                std::memcpy(&bits, &d, sizeof bits);
+                payload = align(8);
+                writeU64(out, bits);
+                break;
+            }
+            case BSONValue::BOOL: payload = std::get<bool>(v.value) ? 1 : 0; break;
+            case BSONValue::ARRAY: {
+                const BSONArray& arr = std::get<BSONArray>(v.value);
+                std::string items;
+                for (const BSONValue& item : arr) value(items, item);
+                payload = align(4);
+                writeU32(out, static_cast<uint32_t>(arr.size()));
+                out += items;
+                break;
+            }
+            case BSONValue::OBJECT: payload = section(*std::get<std::shared_ptr<BSONMap>>(v.value)); break;
+            default: break;
+        }
+        into.push_back(static_cast<char>(v.type));
+        into.append(3, '\0');
+        writeU32(into, payload);
+    }
+};
+}
+
+std::string compileBinary(const BSONMap& document, std::string_view source) {
+    BinaryCompiler compiler;
+    compiler.out.assign(kHeaderSize, '\0');
+    uint32_t root = compiler.section(document);
+
+    std::string header = "BSNB";
+    writeU32(header, kVersion);
+    writeU64(header, sourceHash(source));
+    writeU64(header, source.size());
+    writeU32(header, root);
+    writeU32(header, static_cast<uint32_t>(compiler.out.size()));
+    compiler.out.replace(0, kHeaderSize, header);
+    return std::move(compiler.out);
+}
+
+// Implementation of BinaryRef
+
+BSONValue::Type BinaryRef::type() const { return kind; }
+
+std::string_view BinaryRef::asString() const {
+    return {base + payload + 4, readU32(base + payload)};
+}
+
+int BinaryRef::asInt() const { return static_cast<int>(payload); }
+
+double BinaryRef::asFloat() const {
+    uint64_t bits = readU64(base + payload);
+    double d;
+    std::memcpy(&d, &bits, sizeof d);
+    return d;
+}
+
+bool BinaryRef::asBool() const { return payload != 0; }
+
+size_t BinaryRef::size() const {
+    if (kind != BSONValue::ARRAY && kind != BSONValue::OBJECT) return 0;
+    return readU32(base + payload);
+}
+
+const char* BinaryRef::entryAt(size_t position) const {
+    return base + payload + 4 + position * kEntrySize;
+}
+
+BinaryRef BinaryRef::operator[](size_t position) const {
+    const char* slot = kind == BSONValue::OBJECT ? entryAt(position) + 4 : base + payload + 4 + position * kValueSize;
+    return BinaryRef(base, static_cast<BSONValue::Type>(static_cast<unsigned char>(slot[0])), readU32(slot + 4));
+}
+
+std::string_view BinaryRef::keyAt(size_t position) const {
+    uint32_t key = readU32(entryAt(position));
+    return {base + key + 4, readU32(base + key)};
+}
+
+// find
+// The entries are sorted by key, so this is a binary search over the
+// section's offset table.
+BinaryRef BinaryRef::find(std::string_view key) const {
+    if (kind != BSONValue::OBJECT) return BinaryRef();
+    size_t lo = 0, hi = size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = keyAt(mid).compare(key);
+        if (cmp == 0) return (*this)[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return BinaryRef();
+}
+
+BSONValue BinaryRef::toBSONValue() const {
+    switch (kind) {
+        case BSONValue::STRING: return BSONValue(std::string(asString()));
+        case BSONValue::INT: return BSONValue(asInt());
+        case BSONValue::FLOAT: return BSONValue(asFloat());
+        case BSONValue::BOOL: return BSONValue(asBool());
+        case BSONValue::ARRAY: {
+            BSONArray arr;
+            arr.reserve(size());
+            for (size_t i = 0; i < size(); i++) arr.push_back((*this)[i].toBSONValue());
+            return BSONValue(arr);
+        }
+        case BSONValue::OBJECT: {
+            auto map = std::make_shared<BSONMap>();
+            for (size_t i = 0; i < size(); i++) {
+                map->emplace_hint(map->end(), std::string(keyAt(i)), (*this)[i].toBSONValue());
+            }
+            return BSONValue(map);
+        }
+        default: return BSONValue();
+    }
+}
+
+// Implementation of BinaryDocument
+
+BinaryDocument::BinaryDocument(std::string blob) : owned(std::move(blob)) { validate(); }
+
+BinaryDocument::BinaryDocument(MappedFile mapped) : file(std::move(mapped)) { validate(); }
+
+void BinaryDocument::validate() const {
+    std::string_view b = bytes();
+    if (b.size() < kHeaderSize || b.substr(0, 4) != "BSNB" || readU32(b.data() + 4) != kVersion ||
+        readU32(b.data() + 28) != b.size() || readU32(b.data() + 24) >= b.size()) {
+        throw std::runtime_error("Not a compiled BSON document");
+    }
+}
+
+BinaryDocument BinaryDocument::open(const std::string& path) {
+    return BinaryDocument(MappedFile(path));
+}
+
+bool BinaryDocument::isCurrent(std::string_view blob, std::string_view source) {
+    return blob.size() >= kHeaderSize && blob.substr(0, 4) == "BSNB" && readU32(blob.data() + 4) == kVersion &&
+           readU64(blob.data() + 16) == source.size() && readU64(blob.data() + 8) == sourceHash(source);
+}
+
+// replaceFile
+// Writes blob to a fresh file next to path and renames it over path, so a
+// process that has the old blob mapped keeps reading it intact, and a crash
+// mid-write leaves the old file in place instead of a torn one. Best
+// effort: if either step fails, the temporary file is removed and path is
+// left as it was.
+static void replaceFile(const std::string& path, const std::string& blob) {
+    // Unique per thread and moment, so concurrent loads never share it
+    std::string temp = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+                       "-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+    out.close();
+    if (!out || std::rename(temp.c_str(), path.c_str()) != 0) std::remove(temp.c_str());
+}
+
+BinaryDocument BinaryDocument::load(const std::string& path, std::string_view source) {
+    try {
+        MappedFile mapped(path);
+        if (isCurrent(mapped.view(), source)) return BinaryDocument(std::move(mapped));
+    } catch (const std::runtime_error&) {
+        // Missing or unreadable: compile it below
+    }
+
+    BSONParser parser;
+    BSONTreeBuilder builder;
+    parser.parse(source, builder);
+    std::string blob = compileBinary(*builder.root(), source);
+    replaceFile(path, blob);
+    return BinaryDocument(std::move(blob));
+}
+
+BinaryRef BinaryDocument::root() const {
+    return BinaryRef(bytes().data(), BSONValue::OBJECT, readU32(bytes().data() + 24));
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "BSONParser.hpp"
+#include "MappedFile.hpp"
+
+// Compiled BSON Format
+// A parsed document serialized so it can be used straight from a memory
+// mapping. All integers are little-endian; offsets are from the start of
+// the blob and all records are 4-byte aligned (doubles 8-byte aligned).
+//
+//   header   "BSNB", u32 version, u64 source hash, u64 source size,
+//            u32 root section offset, u32 blob size              (32 bytes)
+//   value    u8 type (BSONValue::Type), 3 bytes padding, u32 payload:
+//            the int, the bool, or the offset of a string, double,
+//            array or section record; unused for MissingNo       (8 bytes)
+//   string   u32 length, bytes
+//   double   8 bytes
+//   array    u32 count, count values
+//   section  u32 count, count entries of u32 key offset (a string record)
+//            followed by a value, sorted by key like BSONMap
+//
+// Keys are stored once per blob, however many sections use them.
+namespace BSONBinaryFormat {
+    constexpr uint32_t kVersion = 1;
+    constexpr size_t kHeaderSize = 32;
+}
+
+// Serializes a parsed document. source is the text it was parsed from; its
+// hash goes in the header so stale blobs can be detected.
+std::string compileBinary(const BSONMap& document, std::string_view source);
+
+// BinaryRef Class
+// Read-only view of one value in a compiled blob, with the same accessors
+// as TapeRef. Nothing is decoded or allocated until asked for. An invalid
+// ref (e.g. a key that was not found) tests false.
+class BinaryRef {
+public:
+    BinaryRef() = default;
+    BinaryRef(const char* base, BSONValue::Type type, uint32_t payload) : base(base), kind(type), payload(payload) {}
+
+    explicit operator bool() const { return base != nullptr; }
+
+    BSONValue::Type type() const;
+    std::string_view asString() const;
+    int asInt() const;
+    double asFloat() const;
+    bool asBool() const;
+
+    // Sections and arrays: number of members / elements
+    size_t size() const;
+    // Arrays: the element at the given position. Sections: the value of the
+    // member at that position, in key order.
+    BinaryRef operator[](size_t position) const;
+    // Sections: the key of the member at the given position
+    std::string_view keyAt(size_t position) const;
+    // Sections: binary search for key, or an invalid ref
+    BinaryRef find(std::string_view key) const;
+
+    // Deep-copies the value into the regular BSONValue representation
+    BSONValue toBSONValue() const;
+
+private:
+    const char* base = nullptr; // Start of the blob
+    BSONValue::Type kind = BSONValue::NULL_TYPE;
+    uint32_t payload = 0;       // As stored in the value
+
+    // Sections: the entry at the given position
+    const char* entryAt(size_t position) const;
+};
+
+// BinaryDocument Class
+// A compiled blob, either memory-mapped from a file or held in memory.
+// Blobs are trusted: only the header is validated, so load blobs produced
+// by compileBinary. Throws std::runtime_error on a missing or bad header.
+class BinaryDocument {
+public:
+    explicit BinaryDocument(std::string blob);
+    explicit BinaryDocument(MappedFile file);
+
+    // Maps a compiled file without checking what it was compiled from
+    static BinaryDocument open(const std::string& path);
+    // Maps path if it was compiled from source by this format version;
+    // otherwise parses source with BSONParser::parse and replaces path with
+    // a fresh blob (best effort) for the next start. The new blob is renamed
+    // over the old one, so documents still mapping the old one stay valid.
+    static BinaryDocument load(const std::string& path, std::string_view source);
+    // True if blob has a valid header and was compiled from source
+    static bool isCurrent(std::string_view blob, std::string_view source);
+
+    BinaryRef root() const;
+    BinaryRef find(std::string_view key) const { return root().find(key); }
+    std::string_view bytes() const { return file ? file->view() : std::string_view(owned); }
+
+private:
+    std::optional<MappedFile> file;
+    std::string owned;
+
+    void validate() const;
+};
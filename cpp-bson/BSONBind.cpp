@@ -0,0 +1,63 @@
+#include "BSONBind.hpp"
+
+BSONBindHandler::BSONBindHandler(void* object, const BSONBindType& type, const BSONParser* parser)
+    : parser(parser) {
+    frames.push_back({object, &type});
+}
+
+// mismatch
+// Records a type error on the current line and stops the parse.
+bool BSONBindHandler::mismatch() {
+    failure = {BSON_ERR_TYPE, parser ? parser->line() : 0};
+    return false;
+}
+
+bool BSONBindHandler::onSectionOpen(std::string_view key, int level) {
+    if (skipLevel != 0) return true;
+    const Frame& parent = frames.back();
+    int i = parent.type->find(key);
+    if (i < 0) {
+        // Not in the schema: ignore the section and everything nested in it
+        skipLevel = level;
+        return true;
+    }
+    const BSONBindField& target = parent.type->fields[i];
+    if (!target.section) return mismatch();
+    frames.push_back({target.section(parent.object), target.sectionType});
+    return true;
+}
+
+bool BSONBindHandler::onSectionClose(int level) {
+    if (skipLevel != 0) {
+        if (level == skipLevel) skipLevel = 0;
+        return true;
+    }
+    frames.pop_back();
+    return true;
+}
+
+bool BSONBindHandler::onKey(std::string_view key) {
+    if (skipLevel != 0) return true;
+    int i = frames.back().type->find(key);
+    field = i < 0 ? nullptr : &frames.back().type->fields[i];
+    return true;
+}
+
+bool BSONBindHandler::onValue(const TokenView& value) {
+    if (skipLevel != 0 || !field) return true;
+    if (arrayDepth == 0) return (field->value && field->value(frames.back().object, value)) || mismatch();
+    return field->element(frames.back().object, value) || mismatch();
+}
+
+bool BSONBindHandler::onArrayStart() {
+    arrayDepth++;
+    if (skipLevel != 0 || !field) return true;
+    // Elements must be scalars: nested arrays have no member type to go to
+    if (arrayDepth > 1 || !field->arrayStart) return mismatch();
+    return field->arrayStart(frames.back().object);
+}
+
+bool BSONBindHandler::onArrayEnd() {
+    arrayDepth--;
+    return true;
+}
@@ -0,0 +1,365 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "BSONParser.hpp"
+
+// Schema binding
+// Parses BSON straight into C++ structs, with no BSONValue tree in between.
+// A struct is made bindable by listing its members, at global scope:
+//
+//     struct Pool { int max_connections = 10; std::vector<int> ports; };
+//     BSON_FIELDS(Pool, max_connections, ports)
+//     struct Database { std::string host; Pool pool; };
+//     BSON_FIELDS(Database, host, pool)
+//
+//     Database db = bindBSON<Database>(content);
+//
+// Members named like keys take their values; members that are bindable
+// structs take the section of that name, so (o) database (o) / (O) pool (O)
+// map onto nested structs. Supported member types are int, double (which
+// also accepts ints), bool, std::string, std::optional of those (MissingNo
+// clears it), std::vector of those for arrays, and bindable structs.
+//
+// Keys and sections the struct does not list are skipped. A value of the
+// wrong type throws "Target is immune!" (bindBSON) or reports
+// BSON_ERR_TYPE on its line (tryBindBSON). A repeated key overwrites the
+// member and a repeated section starts its struct over from the defaults,
+// as in a parsed BSONMap.
+
+// BSONField Structure
+// One member of a schema: its key and its pointer-to-member.
+template <typename T, typename M>
+struct BSONField {
+    using Member = M;
+    const char* name;
+    M T::*member;
+};
+
+template <typename T, typename M>
+constexpr BSONField<T, M> bsonField(const char* name, M T::*member) {
+    return {name, member};
+}
+
+// BSONSchema Structure
+// Specialized by BSON_FIELDS for every bindable struct.
+template <typename T>
+struct BSONSchema {
+    static constexpr bool bound = false;
+};
+
+// BSONBindField / BSONBindType
+// Type-erased view of a schema used by BSONBindHandler: per key, how to
+// store a value, an array element or open a section. Null entries reject
+// that kind of value.
+struct BSONBindType;
+
+struct BSONBindField {
+    bool (*value)(void* object, const TokenView& token);
+    bool (*arrayStart)(void* object);
+    bool (*element)(void* object, const TokenView& token);
+    void* (*section)(void* object); // Resets the nested struct and returns it
+    const BSONBindType* sectionType;
+};
+
+struct BSONBindType {
+    int (*find)(std::string_view key); // Field index, or -1
+    const BSONBindField* fields;
+};
+
+// BSONPerfectHash Structure
+// Collision-free hash of a schema's keys, found at compile time: seeds are
+// tried until every key lands in its own slot of a table four times the
+// key count. A lookup is then one hash and one key comparison.
+constexpr uint64_t bsonBindHash(std::string_view key, uint64_t seed) {
+    uint64_t h = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+    for (char c : key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ull;
+    }
+    return h ^ (h >> 29);
+}
+
+template <size_t N>
+struct BSONPerfectHash {
+    static constexpr size_t slotCount() {
+        size_t n = 1;
+        while (n < N * 4) n <<= 1;
+        return n;
+    }
+
+    std::array<std::string_view, N> keys{};
+    std::array<int, slotCount()> slots{};
+    uint64_t seed = 0;
+
+    constexpr explicit BSONPerfectHash(const std::array<std::string_view, N>& names) : keys(names) {
+        for (;; seed++) {
+            if (seed == 100000) throw std::logic_error("BSON_FIELDS lists a key twice");
+            for (int& slot : slots) slot = -1;
+            bool clash = false;
+            for (size_t i = 0; i < N && !clash; i++) {
+                int& slot = slots[bsonBindHash(keys[i], seed) & (slotCount() - 1)];
+                clash = slot != -1;
+                slot = static_cast<int>(i);
+            }
+            if (!clash) return;
+        }
+    }
+
+    constexpr int find(std::string_view key) const {
+        int i = slots[bsonBindHash(key, seed) & (slotCount() - 1)];
+        return i >= 0 && keys[static_cast<size_t>(i)] == key ? i : -1;
+    }
+};
+
+// BSONBindValue Structure
+// How a member type takes a value. The primary template rejects everything.
+template <typename M, typename = void>
+struct BSONBindValue {
+    static constexpr bool array = false;
+    static bool assign(M&, const TokenView&) { return false; }
+};
+
+template <>
+struct BSONBindValue<int> {
+    static constexpr bool array = false;
+    static bool assign(int& out, const TokenView& token) {
+        if (token.type != TOKEN_NUMBER || token.isFloat) return false;
+        out = token.intValue;
+        return true;
+    }
+};
+
+template <>
+struct BSONBindValue<double> {
+    static constexpr bool array = false;
+    static bool assign(double& out, const TokenView& token) {
+        if (token.type != TOKEN_NUMBER) return false;
+        out = token.isFloat ? token.floatValue : token.intValue;
+        return true;
+    }
+};
+
+template <>
+struct BSONBindValue<bool> {
+    static constexpr bool array = false;
+    static bool assign(bool& out, const TokenView& token) {
+        if (token.type != TOKEN_BOOL) return false;
+        out = token.literal == "true";
+        return true;
+    }
+};
+
+template <>
+struct BSONBindValue<std::string> {
+    static constexpr bool array = false;
+    static bool assign(std::string& out, const TokenView& token) {
+        if (token.type != TOKEN_STRING) return false;
+        out.assign(token.literal.data(), token.literal.size());
+        return true;
+    }
+};
+
+template <typename V>
+struct BSONBindValue<std::optional<V>> {
+    static constexpr bool array = false;
+    static bool assign(std::optional<V>& out, const TokenView& token) {
+        if (token.type == TOKEN_NULL) {
+            out.reset();
+            return true;
+        }
+        V value{};
+        if (!BSONBindValue<V>::assign(value, token)) return false;
+        out = std::move(value);
+        return true;
+    }
+};
+
+template <typename V>
+struct BSONBindValue<std::vector<V>> {
+    static constexpr bool array = true;
+    static bool assign(std::vector<V>&, const TokenView&) { return false; }
+    static bool append(std::vector<V>& out, const TokenView& token) {
+        V value{};
+        if (!BSONBindValue<V>::assign(value, token)) return false;
+        out.push_back(std::move(value));
+        return true;
+    }
+};
+
+template <typename T>
+struct BSONBindTable;
+
+// BSONBindMember Structure
+// The BSONBindField of member I of T, generated from its type.
+template <typename T, size_t I>
+struct BSONBindMember {
+    using Member = typename std::tuple_element_t<I, decltype(BSONSchema<T>::fields())>::Member;
+
+    static Member& get(void* object) {
+        return static_cast<T*>(object)->*(std::get<I>(BSONSchema<T>::fields()).member);
+    }
+    static bool value(void* object, const TokenView& token) { return BSONBindValue<Member>::assign(get(object), token); }
+    static bool arrayStart(void* object) {
+        get(object).clear();
+        return true;
+    }
+    static bool element(void* object, const TokenView& token) {
+        return BSONBindValue<Member>::append(get(object), token);
+    }
+    static void* section(void* object) {
+        Member& member = get(object);
+        member = Member();
+        return &member;
+    }
+
+    static constexpr BSONBindField field() {
+        if constexpr (BSONSchema<Member>::bound) {
+            return {nullptr, nullptr, nullptr, &section, &BSONBindTable<Member>::type};
+        } else if constexpr (BSONBindValue<Member>::array) {
+            return {nullptr, &arrayStart, &element, nullptr, nullptr};
+        } else {
+            return {&value, nullptr, nullptr, nullptr, nullptr};
+        }
+    }
+};
+
+// BSONBindTable Structure
+// Everything generated for a bindable struct: its key hash and fields.
+template <typename T>
+struct BSONBindTable {
+    static_assert(BSONSchema<T>::bound, "declare the struct's members with BSON_FIELDS");
+    static constexpr size_t count = std::tuple_size_v<decltype(BSONSchema<T>::fields())>;
+
+    template <size_t... I>
+    static constexpr std::array<std::string_view, count> names(std::index_sequence<I...>) {
+        return {{std::string_view(std::get<I>(BSONSchema<T>::fields()).name)...}};
+    }
+    template <size_t... I>
+    static constexpr std::array<BSONBindField, count> makeFields(std::index_sequence<I...>) {
+        return {{BSONBindMember<T, I>::field()...}};
+    }
+
+    static constexpr BSONPerfectHash<count> hash{names(std::make_index_sequence<count>())};
+    static constexpr std::array<BSONBindField, count> fields = makeFields(std::make_index_sequence<count>());
+
+    static int find(std::string_view key) { return hash.find(key); }
+    static constexpr BSONBindType type{&find, fields.data()};
+};
+
+// BSONBindHandler Class
+// BSONHandler that writes the event stream into a bound struct. With the
+// parser that drives it, type errors carry the line they are on.
+class BSONBindHandler : public BSONHandler {
+public:
+    BSONBindHandler(void* object, const BSONBindType& type, const BSONParser* parser = nullptr);
+
+    bool onSectionOpen(std::string_view key, int level) override;
+    bool onSectionClose(int level) override;
+    bool onKey(std::string_view key) override;
+    bool onValue(const TokenView& value) override;
+    bool onArrayStart() override;
+    bool onArrayEnd() override;
+
+    // BSON_ERR_TYPE if a value did not fit its member
+    const BSONError& error() const { return failure; }
+
+private:
+    struct Frame {
+        void* object;
+        const BSONBindType* type;
+    };
+
+    std::vector<Frame> frames;             // Structs of the open sections, root first
+    const BSONBindField* field = nullptr;  // Member of the pending key, if bound
+    int skipLevel = 0;                     // Level of the unbound section being skipped
+    int arrayDepth = 0;
+    const BSONParser* parser;
+    BSONError failure;
+
+    bool mismatch();
+};
+
+// BSONBinder Class
+// Typed front end of BSONBindHandler for a bindable struct.
+template <typename T>
+class BSONBinder : public BSONBindHandler {
+public:
+    explicit BSONBinder(T& target, const BSONParser* parser = nullptr)
+        : BSONBindHandler(&target, BSONBindTable<T>::type, parser) {}
+};
+
+// tryBindBSON
+// Parses content into target, which keeps its defaults for absent keys.
+// Never throws on invalid input: returns the parse or type error instead.
+template <typename T>
+BSONError tryBindBSON(std::string_view content, T& target) {
+    BSONParser parser;
+    BSONBinder<T> binder(target, &parser);
+    BSONError error = parser.tryParse(content, binder);
+    return error ? error : binder.error();
+}
+
+// bindBSON
+// Throwing variant, like BSONParser::parse.
+template <typename T>
+T bindBSON(std::string_view content) {
+    T target{};
+    BSONError error = tryBindBSON(content, target);
+    if (error) throw std::runtime_error(error.message());
+    return target;
+}
+
+// BSON_FIELDS(Type, member...)
+// Declares the schema of Type: each member binds to the key of its name.
+// Up to 24 members; use at global scope.
+#define BSON_FIELDS(Type, ...)                                                         \
+    template <>                                                                        \
+    struct BSONSchema<Type> {                                                          \
+        static constexpr bool bound = true;                                            \
+        static constexpr auto fields() {                                               \
+            return std::make_tuple(BSON_BIND_EACH(BSON_BIND_FIELD, Type, __VA_ARGS__)); \
+        }                                                                              \
+    };
+
+#define BSON_BIND_FIELD(Type, member) bsonField(#member, &Type::member)
+
+// BSON_BIND_EACH(F, Type, a, b, ...) expands to F(Type, a), F(Type, b), ...
+#define BSON_BIND_EXPAND(x) x
+#define BSON_BIND_COUNT(...) \
+    BSON_BIND_EXPAND(BSON_BIND_NTH(__VA_ARGS__, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define BSON_BIND_NTH(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, N, ...) N
+#define BSON_BIND_CAT(a, b) BSON_BIND_CAT_(a, b)
+#define BSON_BIND_CAT_(a, b) a##b
+#define BSON_BIND_EACH(F, T, ...) BSON_BIND_EXPAND(BSON_BIND_CAT(BSON_BIND_EACH_, BSON_BIND_COUNT(__VA_ARGS__))(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_1(F, T, a) F(T, a)
+#define BSON_BIND_EACH_2(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_1(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_3(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_2(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_4(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_3(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_5(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_4(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_6(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_5(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_7(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_6(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_8(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_7(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_9(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_8(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_10(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_9(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_11(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_10(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_12(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_11(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_13(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_12(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_14(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_13(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_15(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_14(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_16(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_15(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_17(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_16(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_18(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_17(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_19(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_18(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_20(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_19(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_21(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_20(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_22(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_21(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_23(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_22(F, T, __VA_ARGS__))
+#define BSON_BIND_EACH_24(F, T, a, ...) F(T, a), BSON_BIND_EXPAND(BSON_BIND_EACH_23(F, T, __VA_ARGS__))
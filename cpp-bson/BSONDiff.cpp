@@ -0,0 +1,341 @@
+#include "BSONDiff.hpp"
+#include "BSONWriter.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_set>
+
+// mix
+// Folds value into one hash lane, mixing well enough that reordered or
+// shifted content gives a different hash. The low lane ends in the
+// splitmix64 finalizer and the high lane in murmur3's, so a collision
+// in one is no more likely in the other.
+static uint64_t mixLow(uint64_t seed, uint64_t value) {
+    uint64_t x = seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static uint64_t mixHigh(uint64_t seed, uint64_t value) {
+    uint64_t x = seed ^ (value + 0x7f4a7c159e3779b9ull + (seed << 7) + (seed >> 3));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+static BSONHash combine(BSONHash h, uint64_t value) {
+    return {mixLow(h.low, value), mixHigh(h.high, value)};
+}
+
+static BSONHash seed(uint64_t value) {
+    return combine({0, 0x6a09e667f3bcc909ull}, value);
+}
+
+// Eight bytes at a time, the last word zero-padded behind the length
+static BSONHash combineText(BSONHash h, std::string_view text) {
+    h = combine(h, text.size());
+    for (size_t i = 0; i < text.size(); i += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, text.data() + i, std::min<size_t>(8, text.size() - i));
+        h = combine(h, word);
+    }
+    return h;
+}
+
+static uint64_t floatBits(double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof bits);
+    return bits;
+}
+
+// Implementation of BSONDiffer
+
+BSONPatch BSONDiffer::diff(const BSONMap& before, const BSONMap& after) {
+    BSONPatch patch;
+    std::vector<std::string> path;
+    if (&before != &after) diffSections(before, after, path, patch);
+    return patch;
+}
+
+// diffSections
+// Both maps are sorted by key, so one merged walk pairs up their members.
+void BSONDiffer::diffSections(const BSONMap& before, const BSONMap& after, std::vector<std::string>& path,
+                              BSONPatch& patch) {
+    auto op = [&](BSONPatchOp::Kind kind, const std::string& key, const BSONValue* value) {
+        std::vector<std::string> keys = path;
+        keys.push_back(key);
+        patch.push_back({kind, std::move(keys), value ? *value : BSONValue()});
+    };
+
+    auto a = before.begin();
+    auto b = after.begin();
+    while (a != before.end() || b != after.end()) {
+        if (b == after.end() || (a != before.end() && a->first < b->first)) {
+            op(BSONPatchOp::REMOVE, a->first, nullptr);
+            ++a;
+            continue;
+        }
+        if (a == before.end() || b->first < a->first) {
+            op(BSONPatchOp::SET, b->first, &b->second);
+            ++b;
+            continue;
+        }
+
+        const BSONValue& old = a->second;
+        const BSONValue& now = b->second;
+        if (old.type == BSONValue::OBJECT && now.type == BSONValue::OBJECT) {
+            const auto& oldSection = std::get<std::shared_ptr<BSONMap>>(old.value);
+            const auto& newSection = std::get<std::shared_ptr<BSONMap>>(now.value);
+            if (oldSection != newSection && hash(oldSection) != hash(newSection)) {
+                path.push_back(a->first);
+                diffSections(*oldSection, *newSection, path, patch);
+                path.pop_back();
+            }
+        } else if (!sameValue(old, now)) {
+            op(BSONPatchOp::SET, b->first, &now);
+        }
+        ++a;
+        ++b;
+    }
+}
+
+// sameValue
+// Like operator== but with floats compared by bit pattern, as they are
+// hashed: nan is the same as itself, and 0 and -0 differ.
+bool BSONDiffer::sameValue(const BSONValue& a, const BSONValue& b) {
+    if (a.type != b.type) return false;
+    switch (a.type) {
+        case BSONValue::FLOAT: return floatBits(std::get<double>(a.value)) == floatBits(std::get<double>(b.value));
+        case BSONValue::ARRAY: {
+            const BSONArray& x = std::get<BSONArray>(a.value);
+            const BSONArray& y = std::get<BSONArray>(b.value);
+            if (x.size() != y.size()) return false;
+            for (size_t i = 0; i < x.size(); i++) {
+                if (!sameValue(x[i], y[i])) return false;
+            }
+            return true;
+        }
+        case BSONValue::OBJECT: {
+            const auto& x = std::get<std::shared_ptr<BSONMap>>(a.value);
+            const auto& y = std::get<std::shared_ptr<BSONMap>>(b.value);
+            return x == y || hash(x) == hash(y);
+        }
+        default: return a.value == b.value;
+    }
+}
+
+BSONHash BSONDiffer::hash(const std::shared_ptr<BSONMap>& section) {
+    auto it = hashes.find(section.get());
+    // Same object only if the cached entry shares its control block
+    if (it != hashes.end() && !it->second.owner.owner_before(section) && !section.owner_before(it->second.owner)) {
+        return it->second.hash;
+    }
+    BSONHash value = hashSection(*section);
+
+    if (hashes.size() >= pruneAt) {
+        for (auto entry = hashes.begin(); entry != hashes.end();) {
+            entry = entry->second.owner.expired() ? hashes.erase(entry) : std::next(entry);
+        }
+        pruneAt = std::max<size_t>(1024, 2 * hashes.size());
+    }
+    hashes[section.get()] = {section, value};
+    return value;
+}
+
+BSONHash BSONDiffer::hashSection(const BSONMap& section) {
+    BSONHash h = seed(BSONValue::OBJECT);
+    h = combine(h, section.size());
+    for (const auto& member : section) {
+        h = combineText(h, member.first);
+        h = combineValue(h, member.second);
+    }
+    return h;
+}
+
+BSONHash BSONDiffer::combineValue(BSONHash h, const BSONValue& value) {
+    h = combine(h, value.type);
+    switch (value.type) {
+        case BSONValue::STRING: return combineText(h, std::get<std::string>(value.value));
+        case BSONValue::INT: return combine(h, static_cast<uint64_t>(std::get<int>(value.value)));
+        case BSONValue::FLOAT: return combine(h, floatBits(std::get<double>(value.value)));
+        case BSONValue::BOOL: return combine(h, std::get<bool>(value.value));
+        case BSONValue::NULL_TYPE: return combine(h, 0);
+        case BSONValue::ARRAY: {
+            const BSONArray& elements = std::get<BSONArray>(value.value);
+            h = combine(h, elements.size());
+            for (const BSONValue& element : elements) h = combineValue(h, element);
+            return h;
+        }
+        case BSONValue::OBJECT: {
+            BSONHash section = hash(std::get<std::shared_ptr<BSONMap>>(value.value));
+            return combine(combine(h, section.low), section.high);
+        }
+    }
+    return h;
+}
+
+BSONPatch diffDocuments(const BSONMap& before, const BSONMap& after) {
+    return BSONDiffer().diff(before, after);
+}
+
+// applyPatch
+// Sections copied by this call are recorded in fresh, so later ops on the
+// same section modify the copy instead of copying it again.
+void applyPatch(BSONMap& document, const BSONPatch& patch) {
+    std::unordered_set<const BSONMap*> fresh;
+    for (const BSONPatchOp& op : patch) {
+        if (op.path.empty()) throw std::runtime_error("Cannot apply BSON patch: empty path");
+        BSONMap* map = &document;
+        for (size_t i = 0; i + 1 < op.path.size(); i++) {
+            auto it = map->find(op.path[i]);
+            if (it == map->end()) {
+                if (op.kind == BSONPatchOp::REMOVE) {
+                    map = nullptr;
+                    break;
+                }
+                auto section = std::make_shared<BSONMap>();
+                fresh.insert(section.get());
+                it = map->emplace(op.path[i], BSONValue(std::move(section))).first;
+            } else if (it->second.type != BSONValue::OBJECT) {
+                throw std::runtime_error("Cannot apply BSON patch: \"" + op.path[i] + "\" is not a section");
+            }
+            auto& section = std::get<std::shared_ptr<BSONMap>>(it->second.value);
+            if (!fresh.count(section.get())) {
+                section = std::make_shared<BSONMap>(*section);
+                fresh.insert(section.get());
+            }
+            map = section.get();
+        }
+        if (!map) continue;
+        if (op.kind == BSONPatchOp::SET) {
+            map->insert_or_assign(op.path.back(), op.value);
+        } else {
+            map->erase(op.path.back());
+        }
+    }
+}
+
+// Text form
+
+static void encodeOp(std::string& out, BSONWriter& writer, const char* kind, const std::vector<std::string>& path,
+                     const BSONValue* value) {
+    out += kind;
+    for (const std::string& key : path) {
+        out += ' ';
+        out += std::to_string(key.size());
+        out += ':';
+        out += key;
+    }
+    if (value) {
+        out += " ~> ";
+        if (value->type == BSONValue::OBJECT) {
+            out += "(o)";
+        } else {
+            writer.writeValue(*value);
+        }
+    }
+    out += '\n';
+
+    // A section is rebuilt member by member
+    if (value && value->type == BSONValue::OBJECT) {
+        std::vector<std::string> memberPath = path;
+        for (const auto& member : *std::get<std::shared_ptr<BSONMap>>(value->value)) {
+            memberPath.push_back(member.first);
+            encodeOp(out, writer, "set", memberPath, &member.second);
+            memberPath.pop_back();
+        }
+    }
+}
+
+std::string encodePatch(const BSONPatch& patch) {
+    std::string out;
+    BSONWriter writer(out);
+    for (const BSONPatchOp& op : patch) {
+        bool set = op.kind == BSONPatchOp::SET;
+        encodeOp(out, writer, set ? "set" : "del", op.path, set ? &op.value : nullptr);
+    }
+    return out;
+}
+
+// decodeValue
+// Lexes the value with the document rules and builds it with the same
+// builder as a parse.
+static BSONValue decodeValue(std::string_view text, int line) {
+    if (text == "(o)") return BSONValue(std::make_shared<BSONMap>());
+    Lexer lexer;
+    std::vector<TokenView> tokens;
+    if (!lexer.lexValue(text, line, tokens)) {
+        throw std::runtime_error(std::string("Invalid BSON patch: ") + lexer.error().message() + " (line " + std::to_string(line) + ")");
+    }
+    BSONTreeBuilder builder;
+    builder.onKey("");
+    for (const TokenView& token : tokens) {
+        switch (token.type) {
+            case TOKEN_ARRAY_START: builder.onArrayStart(); break;
+            case TOKEN_ARRAY_END: builder.onArrayEnd(); break;
+            case TOKEN_COMMA: break;
+            default: builder.onValue(token); break;
+        }
+    }
+    return std::move((*builder.root())[""]);
+}
+
+// decodePatch
+// Keys are read by length, not up to a delimiter: they may hold spaces,
+// "~>" or even newlines, which count towards the line numbers of errors.
+// Values run to the end of the line.
+BSONPatch decodePatch(std::string_view text) {
+    BSONPatch patch;
+    size_t pos = 0;
+    int line = 0;
+    while (pos < text.size()) {
+        line++;
+        auto invalid = [&]() {
+            return std::runtime_error("Invalid BSON patch (line " + std::to_string(line) + ")");
+        };
+        BSONPatchOp op{BSONPatchOp::SET, {}, BSONValue()};
+        if (text.compare(pos, 3, "set") == 0) {
+            op.kind = BSONPatchOp::SET;
+        } else if (text.compare(pos, 3, "del") == 0) {
+            op.kind = BSONPatchOp::REMOVE;
+        } else {
+            throw invalid();
+        }
+        pos += 3;
+
+        // " <length>:<key>" for each key
+        while (pos < text.size() && text[pos] == ' ' && text.compare(pos, 4, " ~> ") != 0) {
+            size_t length = 0;
+            const char* digits = text.data() + pos + 1;
+            auto result = std::from_chars(digits, text.data() + text.size(), length);
+            if (result.ec != std::errc() || result.ptr == digits || result.ptr == text.data() + text.size() ||
+                *result.ptr != ':') {
+                throw invalid();
+            }
+            size_t keyStart = static_cast<size_t>(result.ptr - text.data()) + 1;
+            if (length > text.size() - keyStart) throw invalid();
+            op.path.emplace_back(text.substr(keyStart, length));
+            line += static_cast<int>(std::count(op.path.back().begin(), op.path.back().end(), '\n'));
+            pos = keyStart + length;
+        }
+        if (op.path.empty()) throw invalid();
+
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        if (op.kind == BSONPatchOp::SET) {
+            if (text.compare(pos, 4, " ~> ") != 0) throw invalid();
+            op.value = decodeValue(text.substr(pos + 4, end - pos - 4), line);
+        } else if (end != pos) {
+            throw invalid();
+        }
+        patch.push_back(std::move(op));
+        pos = end + 1;
+    }
+    return patch;
+}
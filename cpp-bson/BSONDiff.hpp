@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "BSONParser.hpp"
+
+// BSONPatchOp Structure
+// One change to a document: set or delete the key at the end of path, the
+// keys before it naming the sections that lead there from the root.
+struct BSONPatchOp {
+    enum Kind { SET, REMOVE };
+    Kind kind;
+    std::vector<std::string> path;
+    BSONValue value; // SET only; a section value replaces the key with a whole section
+};
+
+// A patch: ops on distinct keys, so their order does not matter
+using BSONPatch = std::vector<BSONPatchOp>;
+
+// 128-bit content hash: two 64-bit lanes, mixed differently
+struct BSONHash {
+    uint64_t low;
+    uint64_t high;
+    bool operator==(const BSONHash& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const BSONHash& other) const { return !(*this == other); }
+};
+
+// BSONDiffer Class
+// Structural diff of two documents. Sections are compared by pointer first,
+// so subtrees a document shares with the other (see parseShared,
+// BSONIncrementalParser and applyPatch) are skipped at once, and then by a
+// 128-bit content hash: equal hashes are taken as equal content, so
+// unchanged sections are not walked either. For content not crafted to
+// collide (the hash is not cryptographic), the chance that any two of a
+// billion distinct sections share a hash is below 2^-69. Hashes are cached
+// per section for as long as it lives: keep a differ around to diff one
+// document against many. A section must not be modified while its hash is
+// cached (applyPatch never modifies one); clear() forgets them. Floats are
+// compared by bit pattern, so nan is unchanged and 0 to -0 is a change.
+class BSONDiffer {
+public:
+    // The patch turning before into after
+    BSONPatch diff(const BSONMap& before, const BSONMap& after);
+    // Content hash of a section and everything in it
+    BSONHash hash(const std::shared_ptr<BSONMap>& section);
+    void clear() { hashes.clear(); }
+
+private:
+    struct CachedHash {
+        std::weak_ptr<BSONMap> owner; // Tells a freed section from a new one at the same address
+        BSONHash hash;
+    };
+    std::unordered_map<const BSONMap*, CachedHash> hashes;
+    size_t pruneAt = 1024; // Cache size at which expired entries are dropped
+
+    void diffSections(const BSONMap& before, const BSONMap& after, std::vector<std::string>& path, BSONPatch& patch);
+    bool sameValue(const BSONValue& a, const BSONValue& b);
+    BSONHash hashSection(const BSONMap& section);
+    BSONHash combineValue(BSONHash h, const BSONValue& value);
+};
+
+// One-off diff, with a fresh cache
+BSONPatch diffDocuments(const BSONMap& before, const BSONMap& after);
+
+// Applies a patch in place. Sections are never modified: each one on the
+// path of an op is replaced by a copy (once per call), so documents sharing
+// sections with this one are unaffected. SET creates missing sections on
+// its path; deleting a missing key does nothing. Throws std::runtime_error
+// if a path runs through a value that is not a section, or is empty.
+void applyPatch(BSONMap& document, const BSONPatch& patch);
+
+// Text form of a patch, one op per line:
+//
+//   set 2:db 4:pool 3:max ~> 100
+//   set 2:db 5:cache ~> (o)
+//   del 2:db 3:old
+//
+// Each key is prefixed with its length, so any section name fits; values
+// are written as in a document. A section value is written as (o), an empty
+// section, followed by sets of its members. Values that BSONWriter cannot
+// write throw std::runtime_error.
+std::string encodePatch(const BSONPatch& patch);
+// Throws std::runtime_error with the line number if text is not a patch
+BSONPatch decodePatch(std::string_view text);
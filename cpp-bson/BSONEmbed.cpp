@@ -0,0 +1,46 @@
+#include "BSONEmbed.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The line only matters in the compiler's diagnostic
+void bsonEmbedInvalid(BSONErrorCode code, int) {
+    throw std::runtime_error(bsonErrorMessage(code));
+}
+
+void bsonEmbedUnsupported(int line) {
+    throw std::runtime_error("Embedded BSON float cannot be converted at compile time (line " + std::to_string(line) + ")");
+}
+
+double bsonEmbedFloat(std::string_view text) {
+    // The text was validated at compile time, so a failure here means the
+    // compile-time checker and the lexer disagree
+    Lexer lexer;
+    std::vector<TokenView> tokens;
+    if (!lexer.lexValue(text, 1, tokens) || tokens.size() != 1 || tokens[0].type != TOKEN_NUMBER || !tokens[0].isFloat) {
+        throw std::logic_error("Embedded BSON float \"" + std::string(text) + "\" is not a float to the lexer");
+    }
+    return tokens[0].floatValue;
+}
+
+BSONValue EmbeddedRef::toBSONValue() const {
+    switch (type()) {
+        case BSONValue::STRING: return BSONValue(std::string(asString()));
+        case BSONValue::INT: return BSONValue(asInt());
+        case BSONValue::FLOAT: return BSONValue(asFloat());
+        case BSONValue::BOOL: return BSONValue(asBool());
+        case BSONValue::NULL_TYPE: return BSONValue();
+        case BSONValue::ARRAY: {
+            BSONArray elements;
+            elements.reserve(size());
+            for (size_t i = 0; i < size(); i++) elements.push_back((*this)[i].toBSONValue());
+            return BSONValue(std::move(elements));
+        }
+        case BSONValue::OBJECT: {
+            auto map = std::make_shared<BSONMap>();
+            for (size_t i = 0; i < size(); i++) map->emplace(std::string(keyAt(i)), (*this)[i].toBSONValue());
+            return BSONValue(std::move(map));
+        }
+    }
+    return BSONValue();
+}
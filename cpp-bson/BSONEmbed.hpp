@@ -0,0 +1,701 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include "BSONParser.hpp"
+
+// Embedded documents
+// Parses a BSON string literal at compile time into a static, read-only
+// document, so embedded defaults cost nothing at startup:
+//
+//     static constexpr auto defaults = BSON_EMBED(R"(BULBA!
+//     port ~> 8080
+//     (o) database (o)
+//         host ~> "127.0.0.1"
+//     )");
+//     static_assert(defaults.find("port").asInt() == 8080);
+//
+// The grammar and the errors are those of BSONParser. An invalid literal
+// fails the build: the compiler reports a call to bsonEmbedInvalid() with
+// the error code and line. Lookups are constexpr as well.
+//
+// Floats are converted at compile time when that is exact (Clinger's fast
+// path: at most 2^53 for the digits and a power of ten up to 1e22); other
+// floats keep their text and are converted by asFloat() at run time. Floats
+// within a factor of ten of the double range limits fail the build with
+// bsonEmbedUnsupported(), since deciding whether they are in range would
+// need exact arithmetic; so do hex floats that are not normal or need
+// rounding.
+
+// Called on an invalid embedded document; not constexpr, so reaching it
+// during constant evaluation is a compile error. Throws the spec's message
+// if the document is only parsed at run time.
+void bsonEmbedInvalid(BSONErrorCode code, int line);
+// Same, for floats the compile-time path cannot convert exactly
+void bsonEmbedUnsupported(int line);
+
+// EmbeddedNode Structure
+// One value of an embedded document. Sections and arrays refer to a
+// contiguous run of nodes holding their members (sorted by key, duplicates
+// resolved) or elements.
+struct EmbeddedNode {
+    std::string_view key;   // Member key (empty for array elements)
+    BSONValue::Type type = BSONValue::NULL_TYPE;
+    bool boolValue = false;
+    bool exact = true;      // floatValue holds the float (else convert text)
+    int intValue = 0;
+    double floatValue = 0;
+    std::string_view text;  // String contents, or the number as written
+    uint32_t first = 0;     // Sections and arrays: first child node
+    uint32_t size = 0;      // Sections and arrays: number of children
+};
+
+// Converts the text of a float that was not exact at compile time. Throws
+// std::logic_error if the lexer does not read it as a float.
+double bsonEmbedFloat(std::string_view text);
+
+// EmbeddedRef Class
+// A value inside an embedded document, like BinaryRef for compiled blobs.
+// Accessors of the wrong type return 0 / empty.
+class EmbeddedRef {
+public:
+    constexpr EmbeddedRef() = default;
+    constexpr EmbeddedRef(const EmbeddedNode* nodes, uint32_t index) : nodes(nodes), index(index) {}
+
+    constexpr explicit operator bool() const { return nodes != nullptr; }
+
+    constexpr BSONValue::Type type() const { return node().type; }
+    constexpr std::string_view asString() const { return is(BSONValue::STRING) ? node().text : std::string_view(); }
+    constexpr int asInt() const { return is(BSONValue::INT) ? node().intValue : 0; }
+    constexpr double asFloat() const {
+        if (!is(BSONValue::FLOAT)) return 0;
+        return node().exact ? node().floatValue : bsonEmbedFloat(node().text);
+    }
+    constexpr bool asBool() const { return is(BSONValue::BOOL) && node().boolValue; }
+
+    // Sections and arrays: number of members / elements
+    constexpr size_t size() const { return container() ? node().size : 0; }
+    // Arrays: the element at the given position. Sections: the value of the
+    // member at that position, in key order.
+    constexpr EmbeddedRef operator[](size_t position) const {
+        return container() && position < node().size ? EmbeddedRef(nodes, node().first + uint32_t(position)) : EmbeddedRef();
+    }
+    // Sections: the key of the member at the given position
+    constexpr std::string_view keyAt(size_t position) const {
+        return is(BSONValue::OBJECT) && position < node().size ? nodes[node().first + position].key : std::string_view();
+    }
+    // Sections: binary search for key, or an invalid ref
+    constexpr EmbeddedRef find(std::string_view key) const {
+        if (!is(BSONValue::OBJECT)) return EmbeddedRef();
+        uint32_t low = node().first, high = node().first + node().size;
+        while (low < high) {
+            uint32_t mid = low + (high - low) / 2;
+            if (nodes[mid].key < key) low = mid + 1;
+            else high = mid;
+        }
+        return low < node().first + node().size && nodes[low].key == key ? EmbeddedRef(nodes, low) : EmbeddedRef();
+    }
+
+    // Deep-copies the value into the regular BSONValue representation
+    BSONValue toBSONValue() const;
+
+private:
+    const EmbeddedNode* nodes = nullptr;
+    uint32_t index = 0;
+
+    constexpr const EmbeddedNode& node() const { return nodes[index]; }
+    constexpr bool is(BSONValue::Type t) const { return nodes != nullptr && node().type == t; }
+    constexpr bool container() const { return is(BSONValue::OBJECT) || is(BSONValue::ARRAY); }
+};
+
+// EmbeddedDocument Structure
+// Result of BSON_EMBED: Count is the number of nodes the document needs.
+template <size_t Count>
+struct EmbeddedDocument {
+    std::array<EmbeddedNode, Count + 1> nodes{}; // nodes[0] is the root section
+
+    constexpr EmbeddedRef root() const { return EmbeddedRef(nodes.data(), 0); }
+    constexpr EmbeddedRef find(std::string_view key) const { return root().find(key); }
+    BSONMap toBSONMap() const { return *std::get<std::shared_ptr<BSONMap>>(root().toBSONValue().value); }
+};
+
+// Compile-time number conversion, following Lexer::parseNumber (which uses
+// std::from_chars).
+struct BSONEmbedNumber {
+    bool valid = false;
+    bool unsupported = false; // Cannot be converted exactly at compile time
+    bool isFloat = false;
+    bool exact = true;
+    int intValue = 0;
+    double floatValue = 0;
+};
+
+constexpr bool bsonEmbedSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+constexpr bool bsonEmbedDigit(char c) { return c >= '0' && c <= '9'; }
+
+constexpr int bsonEmbedHexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+constexpr bool bsonEmbedKeyChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || bsonEmbedDigit(c) || c == '_';
+}
+
+// Case-insensitive comparison with a lowercase word
+constexpr bool bsonEmbedIEquals(std::string_view s, std::string_view word) {
+    if (s.size() != word.size()) return false;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i] >= 'A' && s[i] <= 'Z' ? char(s[i] - 'A' + 'a') : s[i];
+        if (c != word[i]) return false;
+    }
+    return true;
+}
+
+// inf, infinity, nan and nan(chars), as from_chars reads them
+constexpr bool bsonEmbedSpecial(std::string_view s, double& out) {
+    if (bsonEmbedIEquals(s, "inf") || bsonEmbedIEquals(s, "infinity")) {
+        out = std::numeric_limits<double>::infinity();
+        return true;
+    }
+    if (s.size() < 3 || !bsonEmbedIEquals(s.substr(0, 3), "nan")) return false;
+    std::string_view rest = s.substr(3);
+    if (!rest.empty()) {
+        if (rest.size() < 2 || rest.front() != '(' || rest.back() != ')') return false;
+        for (char c : rest.substr(1, rest.size() - 2)) {
+            if (!bsonEmbedKeyChar(c)) return false;
+        }
+    }
+    out = std::numeric_limits<double>::quiet_NaN();
+    return true;
+}
+
+constexpr bool bsonEmbedInt(std::string_view s, int& out) {
+    bool negative = !s.empty() && s[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if (i == s.size()) return false;
+    long long v = 0;
+    for (; i < s.size(); i++) {
+        if (!bsonEmbedDigit(s[i])) return false;
+        v = v * 10 + (s[i] - '0');
+        if (v > 2147483648ll) return false;
+    }
+    if (negative) v = -v;
+    if (v > std::numeric_limits<int>::max()) return false;
+    out = static_cast<int>(v);
+    return true;
+}
+
+// Decimal floats: the digits are read into an integer m (up to 19 of them)
+// with a power of ten e, value = m * 10^e
+constexpr BSONEmbedNumber bsonEmbedDecimal(std::string_view s, bool negative) {
+    BSONEmbedNumber result;
+    result.isFloat = true;
+    double special = 0;
+    if (bsonEmbedSpecial(s, special)) {
+        result.valid = true;
+        result.floatValue = negative ? -special : special;
+        return result;
+    }
+
+    uint64_t m = 0;
+    int digits = 0;
+    long e = 0;
+    bool any = false, dropped = false;
+    size_t i = 0, n = s.size();
+    for (; i < n && bsonEmbedDigit(s[i]); i++) {
+        any = true;
+        int d = s[i] - '0';
+        if (m == 0 && d == 0) continue;
+        if (digits < 19) {
+            m = m * 10 + uint64_t(d);
+            digits++;
+        } else {
+            e++;
+            dropped = dropped || d != 0;
+        }
+    }
+    if (i < n && s[i] == '.') {
+        for (i++; i < n && bsonEmbedDigit(s[i]); i++) {
+            any = true;
+            int d = s[i] - '0';
+            if (m == 0 && d == 0) {
+                e--;
+            } else if (digits < 19) {
+                m = m * 10 + uint64_t(d);
+                digits++;
+                e--;
+            } else {
+                dropped = dropped || d != 0;
+            }
+        }
+    }
+    if (!any) return result;
+    if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+        size_t j = i + 1;
+        bool negativeExponent = j < n && s[j] == '-';
+        if (j < n && (s[j] == '+' || s[j] == '-')) j++;
+        if (j < n && bsonEmbedDigit(s[j])) {
+            long exponent = 0;
+            for (; j < n && bsonEmbedDigit(s[j]); j++) {
+                if (exponent < 100000) exponent = exponent * 10 + (s[j] - '0');
+            }
+            e += negativeExponent ? -exponent : exponent;
+            i = j;
+        }
+    }
+    if (i != n) return result;
+
+    result.valid = true;
+    if (m == 0) {
+        result.floatValue = negative ? -0.0 : 0.0;
+        return result;
+    }
+    // Order of magnitude: the value is in [10^k, 10^(k+1))
+    long k = digits - 1 + e;
+    if (k > 308 || k < -308) {
+        result.valid = false; // Out of range or subnormal, as at run time
+        return result;
+    }
+    if (k == 308 || k == -308) {
+        result.unsupported = true;
+        return result;
+    }
+
+    const uint64_t limit = uint64_t(1) << 53;
+    while (!dropped && e > 22 && m <= limit / 10) {
+        m *= 10;
+        e--;
+    }
+    if (dropped || m > limit || e > 22 || e < -22) {
+        result.exact = false;
+        return result;
+    }
+    double power = 1;
+    for (long p = 0; p < (e < 0 ? -e : e); p++) power *= 10;
+    double v = e < 0 ? double(m) / power : double(m) * power;
+    result.floatValue = negative ? -v : v;
+    return result;
+}
+
+// Hex floats (after "0x", which a hex digit follows): exact when the digits
+// fit 53 bits and the value is a normal double
+constexpr BSONEmbedNumber bsonEmbedHex(std::string_view s, bool negative) {
+    BSONEmbedNumber result;
+    result.isFloat = true;
+
+    uint64_t m = 0;
+    long e = 0; // Power of two
+    bool any = false, dropped = false;
+    size_t i = 0, n = s.size();
+    for (; i < n && bsonEmbedHexDigit(s[i]) >= 0; i++) {
+        any = true;
+        if (m >> 56) {
+            e += 4;
+            dropped = dropped || bsonEmbedHexDigit(s[i]) != 0;
+        } else {
+            m = m * 16 + uint64_t(bsonEmbedHexDigit(s[i]));
+        }
+    }
+    if (i < n && s[i] == '.') {
+        for (i++; i < n && bsonEmbedHexDigit(s[i]) >= 0; i++) {
+            any = true;
+            if (m >> 56) {
+                dropped = dropped || bsonEmbedHexDigit(s[i]) != 0;
+            } else {
+                m = m * 16 + uint64_t(bsonEmbedHexDigit(s[i]));
+                e -= 4;
+            }
+        }
+    }
+    if (!any) return result;
+    if (i < n && (s[i] == 'p' || s[i] == 'P')) {
+        size_t j = i + 1;
+        bool negativeExponent = j < n && s[j] == '-';
+        if (j < n && (s[j] == '+' || s[j] == '-')) j++;
+        if (j < n && bsonEmbedDigit(s[j])) {
+            long exponent = 0;
+            for (; j < n && bsonEmbedDigit(s[j]); j++) {
+                if (exponent < 100000) exponent = exponent * 10 + (s[j] - '0');
+            }
+            e += negativeExponent ? -exponent : exponent;
+            i = j;
+        }
+    }
+    if (i != n) return result;
+
+    result.valid = true;
+    if (m == 0) {
+        result.floatValue = negative ? -0.0 : 0.0;
+        return result;
+    }
+    while ((m & 1) == 0) {
+        m >>= 1;
+        e++;
+    }
+    int bits = 0;
+    for (uint64_t rest = m; rest != 0; rest >>= 1) bits++;
+    long top = bits - 1 + e;
+    if (top > 1023) {
+        result.valid = false; // Out of range, as at run time
+        return result;
+    }
+    if (dropped || bits > 53 || top < -1022) {
+        result.unsupported = true;
+        return result;
+    }
+    double v = double(m);
+    for (; e > 0; e--) v *= 2;
+    for (; e < 0; e++) v /= 2;
+    result.floatValue = negative ? -v : v;
+    return result;
+}
+
+constexpr BSONEmbedNumber bsonEmbedNumber(std::string_view s) {
+    size_t i = 0;
+    while (i < s.size() && bsonEmbedSpace(s[i])) i++;
+    if (i < s.size() && s[i] == '+') {
+        i++;
+        if (i < s.size() && (s[i] == '+' || s[i] == '-')) return BSONEmbedNumber();
+    }
+    s = s.substr(i);
+
+    BSONEmbedNumber result;
+    if (bsonEmbedInt(s, result.intValue)) {
+        result.valid = true;
+        return result;
+    }
+    bool negative = !s.empty() && s[0] == '-';
+    std::string_view p = negative ? s.substr(1) : s;
+    // As in Lexer::parseNumber: "0x" without a hex digit after it (0xinf)
+    // is a decimal 0 followed by garbage
+    if (p.size() > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') &&
+        (bsonEmbedHexDigit(p[2]) >= 0 || (p[2] == '.' && p.size() > 3 && bsonEmbedHexDigit(p[3]) >= 0))) {
+        return bsonEmbedHex(p.substr(2), negative);
+    }
+    return bsonEmbedDecimal(p, negative);
+}
+
+// BSONEmbedParser Class
+// The compile-time counterpart of the Lexer and BSONParser pair, over the
+// same rules. Members of open sections and arrays are collected on a
+// scratch stack and copied into nodes as one contiguous run when they
+// close, as ArenaBuilder does. With Capacity 0 it only validates and counts
+// the nodes, which sizes the real parse.
+template <size_t Capacity>
+class BSONEmbedParser {
+public:
+    static constexpr bool counting = Capacity == 0;
+
+    constexpr explicit BSONEmbedParser(std::string_view text) : text(text) {}
+
+    // Parses the whole text; count() is then the number of nodes needed
+    constexpr void run() {
+        size_t pos = 0;
+        bool firstLine = true;
+        while (pos < text.size()) {
+            size_t end = text.find('\n', pos);
+            if (end == std::string_view::npos) end = text.size();
+            std::string_view line = text.substr(pos, end - pos);
+            pos = end + 1;
+            lineNum++;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (firstLine) {
+                if (line != "BULBA!") bsonEmbedInvalid(BSON_ERR_HEADER, lineNum);
+                firstLine = false;
+                continue;
+            }
+            parseLine(line);
+        }
+        if (awaitingValue) bsonEmbedInvalid(BSON_ERR_TYPE, lineNum);
+        popTo(1);
+        Run root = commitSection(0);
+        if (!counting) {
+            nodes[0].type = BSONValue::OBJECT;
+            nodes[0].first = root.first;
+            nodes[0].size = root.size;
+        }
+    }
+
+    constexpr size_t count() const { return pushes; }
+
+    std::array<EmbeddedNode, counting ? 1 : Capacity + 1> nodes{};
+
+private:
+    struct Frame {
+        size_t start; // First scratch entry of the section's members
+        size_t entry; // Scratch entry of the section in its parent
+    };
+    struct Run {
+        uint32_t first;
+        uint32_t size;
+    };
+
+    std::string_view text;
+    std::array<EmbeddedNode, counting ? 1 : Capacity> scratch{};
+    size_t top = 0;       // Scratch entries in use
+    uint32_t used = 1;    // Nodes in use (the root is nodes[0])
+    size_t pushes = 0;
+    std::array<Frame, 4> frames{}; // Root and open sections, like BSONParser's stack
+    size_t depth = 1;
+    int currentLevel = 0;
+    int lineNum = 0;
+    bool awaitingValue = false;
+
+    static constexpr std::string_view trim(std::string_view s) {
+        size_t first = s.find_first_not_of(" \t");
+        if (first == std::string_view::npos) return {};
+        size_t last = s.find_last_not_of(" \t");
+        return s.substr(first, last - first + 1);
+    }
+
+    static constexpr bool startsWith(std::string_view s, std::string_view prefix) {
+        return s.size() >= prefix.size() && s.substr(0, prefix.size()) == prefix;
+    }
+
+    static constexpr bool endsWith(std::string_view s, std::string_view suffix) {
+        return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+    }
+
+    // Lexer::lexNextLine and BSONParser::run for one line
+    constexpr void parseLine(std::string_view line) {
+        size_t comment = line.find("zZz");
+        if (comment != std::string_view::npos) line = line.substr(0, comment);
+        while (!line.empty() && bsonEmbedSpace(line.back())) line.remove_suffix(1);
+        if (line.empty()) return;
+
+        size_t spaces = 0;
+        while (spaces < line.size() && line[spaces] == ' ') spaces++;
+        if (spaces < line.size() && line[spaces] == '\t') bsonEmbedInvalid(BSON_ERR_TAB, lineNum);
+        if (spaces % 4 != 0) bsonEmbedInvalid(BSON_ERR_INDENTATION, lineNum);
+        int level = static_cast<int>(spaces / 4);
+        line = trim(line);
+
+        const char* const markers[] = {"(o)", "(O)", "(@)"};
+        for (int headerLevel = 1; headerLevel <= 3; headerLevel++) {
+            std::string_view marker = markers[headerLevel - 1];
+            if (!startsWith(line, marker) || line.size() < 4 || line[3] != ' ') continue;
+            if (!endsWith(line, marker) || line[line.size() - 4] != ' ') continue;
+            // Same slicing as the lexer, also for the overlapping "(o) (o)"
+            std::string_view key = line.size() >= 8 ? line.substr(4, line.size() - 8) : line.substr(4);
+            valueDue();
+            openSection(key, level, headerLevel);
+            return;
+        }
+
+        size_t keyEnd = 0, valueStart = 0;
+        if (!scanKeyValue(line, keyEnd, valueStart)) bsonEmbedInvalid(BSON_ERR_SYNTAX, lineNum);
+        std::string_view value = line.substr(valueStart);
+        checkValue(value);
+        valueDue();
+
+        if (level != currentLevel) {
+            if (level > currentLevel) bsonEmbedInvalid(BSON_ERR_INDENTATION, lineNum);
+            popTo(static_cast<size_t>(level) + 1);
+            currentLevel = level;
+        }
+        std::string_view key = line.substr(0, keyEnd);
+        if (key == "Charizard") bsonEmbedInvalid(BSON_ERR_CHARIZARD, lineNum);
+        if (trim(value).empty()) {
+            awaitingValue = true;
+            return;
+        }
+        storeValue(key, value);
+    }
+
+    // A key left without a value takes the first token of the next line
+    constexpr void valueDue() {
+        if (awaitingValue) bsonEmbedInvalid(BSON_ERR_TYPE, lineNum);
+    }
+
+    constexpr bool scanKeyValue(std::string_view line, size_t& keyEnd, size_t& valueStart) const {
+        size_t i = 0, n = line.size();
+        while (i < n && bsonEmbedKeyChar(line[i])) i++;
+        if (i == 0) return false;
+        keyEnd = i;
+        while (i < n && bsonEmbedSpace(line[i])) i++;
+        size_t whipStart = i;
+        while (i < n && line[i] == '~') i++;
+        if (i == whipStart || i == n || line[i] != '>') return false;
+        i++;
+        while (i < n && bsonEmbedSpace(line[i])) i++;
+        valueStart = i;
+        for (; i < n; i++) {
+            if (line[i] == '\n' || line[i] == '\r') return false;
+        }
+        return true;
+    }
+
+    constexpr void openSection(std::string_view key, int level, int headerLevel) {
+        if (level != headerLevel - 1) bsonEmbedInvalid(BSON_ERR_INDENTATION, lineNum);
+        if (depth < static_cast<size_t>(headerLevel)) bsonEmbedInvalid(BSON_ERR_BADGES, lineNum);
+        if (key == "Charizard") bsonEmbedInvalid(BSON_ERR_CHARIZARD, lineNum);
+        popTo(static_cast<size_t>(headerLevel));
+        EmbeddedNode section;
+        section.key = key;
+        section.type = BSONValue::OBJECT;
+        size_t entry = top;
+        push(section);
+        frames[depth] = {top, entry};
+        depth++;
+        currentLevel = headerLevel;
+    }
+
+    constexpr void popTo(size_t target) {
+        while (depth > target) {
+            depth--;
+            Run run = commitSection(frames[depth].start);
+            if (!counting) {
+                scratch[frames[depth].entry].first = run.first;
+                scratch[frames[depth].entry].size = run.size;
+            }
+        }
+    }
+
+    constexpr void push(const EmbeddedNode& node) {
+        pushes++;
+        if (!counting) scratch[top] = node;
+        top++;
+    }
+
+    // Sorts the members from start by key (stably), keeps the last of each
+    // key and moves them from the scratch stack into nodes
+    constexpr Run commitSection(size_t start) {
+        Run run{used, 0};
+        if (!counting) {
+            for (size_t i = start + 1; i < top; i++) {
+                EmbeddedNode node = scratch[i];
+                size_t j = i;
+                for (; j > start && node.key < scratch[j - 1].key; j--) scratch[j] = scratch[j - 1];
+                scratch[j] = node;
+            }
+            for (size_t i = start; i < top; i++) {
+                if (i + 1 < top && scratch[i + 1].key == scratch[i].key) continue;
+                nodes[used++] = scratch[i];
+                run.size++;
+            }
+        }
+        top = start;
+        return run;
+    }
+
+    // Lexer::tokenizeValue for validation only, before the line's structure
+    // is checked (lexing errors come first)
+    constexpr void checkValue(std::string_view value, int depth = 0) const {
+        std::string_view s = trim(value);
+        if (s.empty() || isString(s) || s == "SuperEffective" || s == "NotVeryEffective" || s == "MissingNo") return;
+        if (isArray(s)) {
+            if (depth == Lexer::kMaxArrayDepth) bsonEmbedInvalid(BSON_ERR_TYPE, lineNum);
+            forEachElement(s, [this, depth](std::string_view element) { checkValue(element, depth + 1); });
+            return;
+        }
+        BSONEmbedNumber number = bsonEmbedNumber(s);
+        if (!number.valid) bsonEmbedInvalid(BSON_ERR_TYPE, lineNum);
+        if (number.unsupported) bsonEmbedUnsupported(lineNum);
+    }
+
+    static constexpr bool isString(std::string_view s) { return startsWith(s, "\"") && endsWith(s, "\""); }
+    static constexpr bool isArray(std::string_view s) { return startsWith(s, "<|") && endsWith(s, "|>"); }
+
+    template <typename F>
+    static constexpr void forEachElement(std::string_view s, F&& visit) {
+        std::string_view inner = s.size() >= 4 ? s.substr(2, s.size() - 4) : s.substr(2);
+        size_t start = 0;
+        while (start < inner.size()) {
+            size_t segmentEnd = elementEnd(inner, start);
+            visit(inner.substr(start, segmentEnd - start));
+            if (segmentEnd == inner.size()) break;
+            start = segmentEnd + 1;
+        }
+    }
+
+    // Lexer::arrayElementEnd: the next comma outside strings and nested arrays
+    static constexpr size_t elementEnd(std::string_view inner, size_t start) {
+        bool quoted = false;
+        int nesting = 0;
+        auto endsString = [&](size_t quote) {
+            size_t next = inner.find_first_not_of(" \t", quote + 1);
+            return next == std::string_view::npos || inner[next] == ',' || (nesting > 0 && quoted && inner.compare(next, 2, "|>") == 0);
+        };
+        for (size_t i = start; i < inner.size(); i++) {
+            char c = inner[i];
+            if (c == '"') {
+                quoted = !endsString(i);
+            } else if (quoted) {
+                continue;
+            } else if (c == ',' && nesting == 0) {
+                return i;
+            } else if (c == '<' && i + 1 < inner.size() && inner[i + 1] == '|') {
+                nesting++;
+                i++;
+            } else if (c == '|' && i + 1 < inner.size() && inner[i + 1] == '>') {
+                if (nesting > 0) nesting--;
+                i++;
+            }
+        }
+        return inner.size();
+    }
+
+    // Pushes a value that checkValue accepted; empty array elements are
+    // dropped, as the parser skips them
+    constexpr void storeValue(std::string_view key, std::string_view value) {
+        std::string_view s = trim(value);
+        if (s.empty()) return;
+        EmbeddedNode node;
+        node.key = key;
+        if (isString(s)) {
+            node.type = BSONValue::STRING;
+            node.text = s.size() >= 2 ? s.substr(1, s.size() - 2) : s.substr(1);
+        } else if (s == "SuperEffective" || s == "NotVeryEffective") {
+            node.type = BSONValue::BOOL;
+            node.boolValue = s == "SuperEffective";
+        } else if (s == "MissingNo") {
+            node.type = BSONValue::NULL_TYPE;
+        } else if (isArray(s)) {
+            size_t start = top;
+            forEachElement(s, [this](std::string_view element) { storeValue({}, element); });
+            node.type = BSONValue::ARRAY;
+            node.first = used;
+            node.size = static_cast<uint32_t>(top - start);
+            if (!counting) {
+                for (size_t i = start; i < top; i++) nodes[used++] = scratch[i];
+            }
+            top = start;
+        } else {
+            BSONEmbedNumber number = bsonEmbedNumber(s);
+            node.type = number.isFloat ? BSONValue::FLOAT : BSONValue::INT;
+            node.intValue = number.intValue;
+            node.floatValue = number.floatValue;
+            node.exact = number.exact;
+            node.text = s;
+        }
+        push(node);
+    }
+};
+
+template <size_t Capacity>
+constexpr EmbeddedDocument<Capacity> embedBSON(std::string_view text) {
+    BSONEmbedParser<Capacity> parser(text);
+    parser.run();
+    EmbeddedDocument<Capacity> document;
+    document.nodes = parser.nodes;
+    return document;
+}
+
+constexpr size_t embedBSONCount(std::string_view text) {
+    BSONEmbedParser<0> parser(text);
+    parser.run();
+    return parser.count();
+}
+
+// BSON_EMBED(literal)
+// The embedded document for a string literal; use it to initialize a
+// constexpr variable so the parse happens at compile time.
+#define BSON_EMBED(text) embedBSON<embedBSONCount(text)>(text)
@@ -0,0 +1,41 @@
+#pragma once
+
+// BSONErrorCode Enum
+// The error responses of BSON_Format.md §8, numbered as in the spec, followed
+// by the statuses the spec defines for the header (§2.1), tabs (§2.2) and
+// the restricted key (§4.1).
+enum BSONErrorCode {
+    BSON_OK = 0,
+    BSON_ERR_SYNTAX = 1,      // "It hurt itself in its confusion!"
+    BSON_ERR_INDENTATION = 2, // "The attack missed!"
+    BSON_ERR_TYPE = 3,        // "Target is immune!"
+    BSON_ERR_BADGES = 4,      // "Not enough badges!"
+    BSON_ERR_HEADER,          // "Status: Fainted"
+    BSON_ERR_TAB,             // "Poison Type: Tab character detected"
+    BSON_ERR_CHARIZARD        // "It burns the bulb"
+};
+
+// The spec's text response for an error code
+inline const char* bsonErrorMessage(BSONErrorCode code) {
+    switch (code) {
+        case BSON_OK: return "";
+        case BSON_ERR_SYNTAX: return "It hurt itself in its confusion!";
+        case BSON_ERR_INDENTATION: return "The attack missed!";
+        case BSON_ERR_TYPE: return "Target is immune!";
+        case BSON_ERR_BADGES: return "Not enough badges!";
+        case BSON_ERR_HEADER: return "Status: Fainted";
+        case BSON_ERR_TAB: return "Poison Type: Tab character detected";
+        case BSON_ERR_CHARIZARD: return "It burns the bulb";
+    }
+    return "";
+}
+
+// BSONError Structure
+// What went wrong and on which line (the Token::line of the failing token).
+struct BSONError {
+    BSONErrorCode code = BSON_OK;
+    int line = 0;
+
+    explicit operator bool() const { return code != BSON_OK; }
+    const char* message() const { return bsonErrorMessage(code); }
+};
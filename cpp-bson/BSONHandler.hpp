@@ -0,0 +1,28 @@
+#pragma once
+#include <string_view>
+#include "Lexer.hpp"
+
+// BSONHandler Interface
+// Receives parse events from BSONParser::parse(content, handler) instead of
+// a fully built BSONMap, so callers can filter or stream a document without
+// materializing it. The parser has already validated structure (evolution
+// levels, badges, indentation, keys) before an event is emitted.
+//
+// Every callback returns true to continue or false to stop parsing early.
+// Keys and string values are views into the parsed buffer.
+class BSONHandler {
+public:
+    virtual ~BSONHandler() = default;
+
+    // A section header; level is the evolution stage: 1 (o), 2 (O), 3 (@)
+    virtual bool onSectionOpen(std::string_view /*key*/, int /*level*/) { return true; }
+    // Emitted when a section ends (dedent, sibling header or end of input)
+    virtual bool onSectionClose(int /*level*/) { return true; }
+    // The key of a key-value pair; its value follows as onValue or an array
+    virtual bool onKey(std::string_view /*key*/) { return true; }
+    // A scalar: TOKEN_STRING, TOKEN_NUMBER, TOKEN_BOOL or TOKEN_NULL
+    virtual bool onValue(const TokenView& /*value*/) { return true; }
+    // <| and |>; the elements arrive as onValue or nested arrays in between
+    virtual bool onArrayStart() { return true; }
+    virtual bool onArrayEnd() { return true; }
+};
@@ -0,0 +1,145 @@
+#include "BSONIncremental.hpp"
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+// diffMaps
+// Appends the path of every key that was added, removed or changed between
+// two maps. Shared sections (a reused chunk) are skipped without a look
+// inside; other sections are compared member by member. Entries of after
+// listed in moved were taken out of before unchanged and are skipped too.
+static void diffMaps(const BSONMap& before, const BSONMap& after, const std::string& prefix,
+                     std::vector<std::string>& out, const std::unordered_set<const BSONValue*>* moved = nullptr) {
+    auto a = before.begin();
+    auto b = after.begin();
+    while (a != before.end() || b != after.end()) {
+        if (moved && b != after.end() && moved->count(&b->second)) {
+            ++b;
+        } else if (b == after.end() || (a != before.end() && a->first < b->first)) {
+            out.push_back(prefix + a->first);
+            ++a;
+        } else if (a == before.end() || b->first < a->first) {
+            out.push_back(prefix + b->first);
+            ++b;
+        } else {
+            const BSONValue& x = a->second;
+            const BSONValue& y = b->second;
+            if (x.type == BSONValue::OBJECT && y.type == BSONValue::OBJECT) {
+                const auto& xs = std::get<std::shared_ptr<BSONMap>>(x.value);
+                const auto& ys = std::get<std::shared_ptr<BSONMap>>(y.value);
+                if (xs != ys) diffMaps(*xs, *ys, prefix + a->first + ".", out);
+            } else if (x != y) {
+                out.push_back(prefix + a->first);
+            }
+            ++a;
+            ++b;
+        }
+    }
+}
+
+// sameEntry
+// Whether the previous document still holds a reused chunk's value: a
+// section only by pointer, so a different one is never walked here.
+static bool sameEntry(const BSONValue& held, const BSONValue& chunk) {
+    if (held.type == BSONValue::OBJECT && chunk.type == BSONValue::OBJECT) {
+        return std::get<std::shared_ptr<BSONMap>>(held.value) == std::get<std::shared_ptr<BSONMap>>(chunk.value);
+    }
+    return held == chunk;
+}
+
+// reparse
+// Splits the new source into chunks and looks each one up by its text among
+// the chunks of the previous source. A chunk parses the same wherever it
+// sits (see BSONParser::splitChunks), so a match is reused as is.
+BSONReload BSONIncrementalParser::reparse(std::string_view newSource) {
+    BSONReload result;
+    std::vector<std::string_view> pieces = BSONParser::splitChunks(newSource, 1);
+
+    // Previous chunks by hash; the first chunk (with the header) only ever
+    // matches the first chunk
+    std::unordered_multimap<size_t, size_t> previous;
+    previous.reserve(chunks.size());
+    for (size_t i = 1; i < chunks.size(); i++) previous.emplace(chunks[i].hash, i);
+
+    std::vector<Chunk> next;
+    next.reserve(pieces.size());
+    BSONParser parser;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        std::string_view piece = pieces[i];
+        Chunk chunk{static_cast<size_t>(piece.data() - newSource.data()), piece.size(),
+                    std::hash<std::string_view>()(piece), nullptr, false};
+
+        const Chunk* match = nullptr;
+        if (i == 0) {
+            if (!chunks.empty() && chunks[0].hash == chunk.hash &&
+                std::string_view(text).substr(chunks[0].offset, chunks[0].length) == piece) {
+                match = &chunks[0];
+            }
+        } else {
+            auto range = previous.equal_range(chunk.hash);
+            for (auto it = range.first; it != range.second && !match; ++it) {
+                const Chunk& old = chunks[it->second];
+                if (std::string_view(text).substr(old.offset, old.length) == piece) match = &old;
+            }
+        }
+
+        if (match) {
+            chunk.map = match->map;
+            chunk.reused = true;
+            result.reusedChunks++;
+        } else {
+            BSONTreeBuilder builder;
+            std::string_view following = i + 1 < pieces.size() ? pieces[i + 1] : std::string_view();
+            if (!parser.run(piece, builder, i > 0, following)) {
+                // Chunk lines count from 1; shift them to document lines
+                result.error = parser.error();
+                result.error.line += static_cast<int>(std::count(newSource.begin(), newSource.begin() + chunk.offset, '\n'));
+                return result;
+            }
+            chunk.map = std::make_shared<BSONMap>(builder.take());
+            result.reparsedChunks++;
+        }
+        next.push_back(std::move(chunk));
+    }
+
+    // Merge newest chunk first, so each key is set once, by the last chunk
+    // that has it, exactly as later lines win in a single parse. If no one
+    // else holds the previous document, an unchanged entry of a reused chunk
+    // is moved out of it, map node and all; otherwise it is copied (sections
+    // by pointer).
+    auto merged = std::make_shared<BSONMap>();
+    std::unordered_set<const BSONValue*> moved;
+    bool own = root.use_count() == 1;
+    for (size_t i = next.size(); i-- > 0;) {
+        const Chunk& chunk = next[i];
+        for (auto entry = chunk.map->begin(); entry != chunk.map->end(); ++entry) {
+            auto slot = merged->lower_bound(entry->first);
+            if (slot != merged->end() && slot->first == entry->first) continue;
+            if (own && chunk.reused) {
+                auto old = root->find(entry->first);
+                if (old != root->end() && sameEntry(old->second, entry->second)) {
+                    moved.insert(&merged->insert(slot, root->extract(old))->second);
+                    continue;
+                }
+            }
+            merged->emplace_hint(slot, entry->first, entry->second);
+        }
+    }
+
+    diffMaps(*root, *merged, "", result.changedKeys, &moved);
+    root = merged;
+    result.value = std::move(merged);
+    text.assign(newSource.data(), newSource.size());
+    chunks = std::move(next);
+    return result;
+}
+
+// applyEdit
+// Edit-range form of reparse: the range is clamped to the current source.
+BSONReload BSONIncrementalParser::applyEdit(size_t offset, size_t length, std::string_view replacement) {
+    std::string edited = text;
+    offset = std::min(offset, edited.size());
+    edited.replace(offset, std::min(length, edited.size() - offset), replacement);
+    return reparse(edited);
+}
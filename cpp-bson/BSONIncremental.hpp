@@ -0,0 +1,56 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BSONParser.hpp"
+
+// BSONReload Structure
+// Outcome of an incremental re-parse.
+struct BSONReload {
+    // The new document, shared with the parser (see document()); null if
+    // the new source is invalid
+    std::shared_ptr<const BSONMap> value;
+    BSONError error;                      // Set if the new source is invalid
+    std::vector<std::string> changedKeys; // Dotted paths added, removed or changed
+    size_t reparsedChunks = 0;            // Chunks that had to be lexed again
+    size_t reusedChunks = 0;              // Chunks taken from the previous parse
+
+    bool ok() const { return !error; }
+};
+
+// BSONIncrementalParser Class
+// Keeps the previous source and its parse, split into chunks at top-level
+// (o) sections (the first chunk holds the header and the leading root keys).
+// On reload, only chunks whose text changed are parsed again; the parsed
+// trees of the others are reused, so their sections are the very same
+// shared_ptr<BSONMap> objects as in the previous document. Treat those
+// sub-maps as immutable: they are shared between successive documents.
+// Root-level values of reused chunks are moved out of the previous document
+// when nothing else holds it (drop BSONReload::value before reloading);
+// otherwise they are copied, as both documents need them.
+class BSONIncrementalParser {
+public:
+    // Parses newSource, reusing every chunk whose text is unchanged since
+    // the last successful call (the first call parses everything). On error
+    // the previous state is kept, so a bad edit can be corrected later.
+    BSONReload reparse(std::string_view newSource);
+    // Replaces length bytes at offset of the current source, then reparses
+    BSONReload applyEdit(size_t offset, size_t length, std::string_view replacement);
+
+    const BSONMap& document() const { return *root; }
+    const std::string& source() const { return text; }
+
+private:
+    struct Chunk {
+        size_t offset; // Into text
+        size_t length;
+        size_t hash;
+        std::shared_ptr<const BSONMap> map; // The chunk parsed on its own, shared by reloads that reuse it
+        bool reused;
+    };
+
+    std::string text;
+    std::vector<Chunk> chunks;
+    std::shared_ptr<BSONMap> root = std::make_shared<BSONMap>(); // Handed out as const only
+};
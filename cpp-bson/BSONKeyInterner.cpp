@@ -0,0 +1,31 @@
+#include "BSONKeyInterner.hpp"
+#include <mutex>
+
+// intern
+// Hits only take the shared lock; a miss retakes it exclusively and checks
+// again, since another thread may have added the key in between.
+BSONKey BSONKeyInterner::intern(std::string_view key) {
+    if (BSONKey found = lookup(key)) return found;
+
+    std::unique_lock<std::shared_mutex> lock(mutex, std::defer_lock);
+    if (threadSafe) lock.lock();
+    auto it = index.find(key);
+    if (it != index.end()) return BSONKey(it->second);
+
+    const std::string& stored = storage.emplace_back(key);
+    index.emplace(stored, &stored);
+    return BSONKey(&stored);
+}
+
+BSONKey BSONKeyInterner::lookup(std::string_view key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex, std::defer_lock);
+    if (threadSafe) lock.lock();
+    auto it = index.find(key);
+    return it == index.end() ? BSONKey() : BSONKey(it->second);
+}
+
+size_t BSONKeyInterner::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex, std::defer_lock);
+    if (threadSafe) lock.lock();
+    return storage.size();
+}
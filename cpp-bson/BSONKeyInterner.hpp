@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// BSONKey Class
+// Handle to a key owned by a BSONKeyInterner. An interner stores each
+// distinct key once, so two handles from the same interner are equal exactly
+// when they name the same key: comparing and hashing them is a pointer
+// operation.
+class BSONKey {
+public:
+    BSONKey() = default;
+
+    explicit operator bool() const { return entry != nullptr; }
+    std::string_view str() const { return entry ? std::string_view(*entry) : std::string_view(); }
+
+    bool operator==(BSONKey other) const { return entry == other.entry; }
+    bool operator!=(BSONKey other) const { return entry != other.entry; }
+
+private:
+    friend class BSONKeyInterner;
+    friend struct std::hash<BSONKey>;
+
+    explicit BSONKey(const std::string* entry) : entry(entry) {}
+    const std::string* entry = nullptr;
+};
+
+template <>
+struct std::hash<BSONKey> {
+    size_t operator()(BSONKey key) const { return std::hash<const void*>()(key.entry); }
+};
+
+// BSONKeyInterner Class
+// Table of distinct key strings that any number of parses can share.
+// Keys never move or go away while the interner lives, so str() views of
+// its handles stay valid for that long. Constructed thread-safe, it may be
+// shared by parsers on different threads; otherwise it must stay on one.
+class BSONKeyInterner {
+public:
+    explicit BSONKeyInterner(bool threadSafe = false) : threadSafe(threadSafe) {}
+
+    BSONKeyInterner(const BSONKeyInterner&) = delete;
+    BSONKeyInterner& operator=(const BSONKeyInterner&) = delete;
+
+    // The handle for key, adding it to the table on first use
+    BSONKey intern(std::string_view key);
+    // The handle for key if it was interned before, else an invalid handle
+    BSONKey lookup(std::string_view key) const;
+
+    // Number of distinct keys
+    size_t size() const;
+
+private:
+    std::deque<std::string> storage; // A deque never moves its elements
+    std::unordered_map<std::string_view, const std::string*> index;
+    mutable std::shared_mutex mutex;
+    bool threadSafe;
+};
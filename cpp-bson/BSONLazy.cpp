@@ -0,0 +1,122 @@
+#include "BSONLazy.hpp"
+#include <algorithm>
+
+// decode
+// Lexes a value span and builds its BSONValue with the same builder as a
+// full parse, so both agree on every value.
+static const BSONValue& decode(const LazyEntry& entry) {
+    if (!entry.cached) {
+        Lexer lexer{std::string_view()};
+        std::vector<TokenView> tokens;
+        if (!lexer.lexValue(entry.raw, entry.line, tokens)) throw std::runtime_error(lexer.error().message());
+
+        BSONTreeBuilder builder;
+        builder.onKey("");
+        for (const TokenView& token : tokens) {
+            switch (token.type) {
+                case TOKEN_ARRAY_START: builder.onArrayStart(); break;
+                case TOKEN_ARRAY_END: builder.onArrayEnd(); break;
+                case TOKEN_COMMA: break;
+                default: builder.onValue(token); break;
+            }
+        }
+        entry.cached = std::make_unique<BSONValue>(std::move((*builder.root())[""]));
+    }
+    return *entry.cached;
+}
+
+// parseLazy
+// Same grammar as parse(), except that values are not lexed until read.
+LazyDocument BSONParser::parseLazy(std::string_view content) {
+    LazyDocument document;
+    LazyBuilder builder(document);
+    lazyValues = true;
+    run(content, builder);
+    lazyValues = false;
+    if (failure) throw std::runtime_error(failure.message());
+    builder.finish();
+    return document;
+}
+
+// Implementation of LazySection
+
+const LazyEntry* LazySection::entry(std::string_view key) const {
+    auto it = std::lower_bound(members.begin(), members.end(), key,
+                               [](const LazyEntry& entry, std::string_view k) { return entry.key < k; });
+    return it != members.end() && it->key == key ? &*it : nullptr;
+}
+
+const BSONValue* LazySection::get(std::string_view key) const {
+    const LazyEntry* found = entry(key);
+    if (!found || found->section) return nullptr;
+    return &decode(*found);
+}
+
+const LazySection* LazySection::section(std::string_view key) const {
+    const LazyEntry* found = entry(key);
+    return found ? found->section.get() : nullptr;
+}
+
+BSONMap LazySection::toBSONMap() const {
+    BSONMap result;
+    for (const LazyEntry& entry : members) {
+        BSONValue value = entry.section ? BSONValue(std::make_shared<BSONMap>(entry.section->toBSONMap())) : decode(entry);
+        result.emplace_hint(result.end(), std::string(entry.key), std::move(value));
+    }
+    return result;
+}
+
+// Implementation of LazyBuilder
+
+// seal
+// Members arrive in document order; sorts them by key and keeps the last
+// of each, as later lines win (a section replaces an earlier member too).
+static void seal(std::vector<LazyEntry>& members) {
+    auto byKey = [](const LazyEntry& a, const LazyEntry& b) { return a.key < b.key; };
+    if (!std::is_sorted(members.begin(), members.end(), byKey)) std::stable_sort(members.begin(), members.end(), byKey);
+    auto kept = members.begin();
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        if (std::next(it) != members.end() && std::next(it)->key == it->key) continue;
+        if (kept != it) *kept = std::move(*it);
+        ++kept;
+    }
+    members.erase(kept, members.end());
+}
+
+LazyBuilder::LazyBuilder(LazyDocument& document) {
+    sections.push_back(document.rootSection.get());
+}
+
+bool LazyBuilder::onSectionOpen(std::string_view key, int /*level*/) {
+    LazyEntry entry;
+    entry.key = key;
+    entry.section = std::make_unique<LazySection>();
+    LazySection* section = entry.section.get();
+    sections.back()->members.push_back(std::move(entry));
+    sections.push_back(section);
+    return true;
+}
+
+bool LazyBuilder::onSectionClose(int /*level*/) {
+    seal(sections.back()->members);
+    sections.pop_back();
+    return true;
+}
+
+bool LazyBuilder::onKey(std::string_view key) {
+    pendingKey = key;
+    return true;
+}
+
+bool LazyBuilder::onValue(const TokenView& value) {
+    LazyEntry entry;
+    entry.key = pendingKey;
+    entry.raw = value.literal;
+    entry.line = value.line;
+    sections.back()->members.push_back(std::move(entry));
+    return true;
+}
+
+void LazyBuilder::finish() {
+    seal(sections.front()->members);
+}
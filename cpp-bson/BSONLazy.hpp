@@ -0,0 +1,83 @@
+#pragma once
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "BSONParser.hpp"
+
+class LazySection;
+
+// LazyEntry Structure
+// One member of a lazy section: a nested section, or the source span of a
+// value that is decoded the first time it is read.
+struct LazyEntry {
+    std::string_view key;
+    std::string_view raw;                 // Value text as written (empty for sections)
+    int line = 0;                         // Line the value is on
+    std::unique_ptr<LazySection> section; // Set for sections
+    mutable std::unique_ptr<BSONValue> cached; // Allocated when first decoded
+};
+
+// LazySection Class
+// A section of a LazyDocument: a flat vector of its members, sorted by key
+// and searched by binary search. Lookups decode on demand and cache the
+// result, which makes them non-const in effect: a document must not be read
+// from several threads at once. Invalid values are only detected when they
+// are decoded, and then throw std::runtime_error with the spec's message;
+// one overwritten by a later duplicate key is never decoded at all.
+class LazySection {
+public:
+    // The value under key, decoded on first access; nullptr if the key is
+    // absent or names a section
+    const BSONValue* get(std::string_view key) const;
+    // The nested section under key, or nullptr
+    const LazySection* section(std::string_view key) const;
+    // The member under key, decoded or not, or nullptr
+    const LazyEntry* entry(std::string_view key) const;
+    bool contains(std::string_view key) const { return entry(key) != nullptr; }
+    size_t size() const { return members.size(); }
+
+    // Members in key order, decoded or not
+    const std::vector<LazyEntry>& entries() const { return members; }
+    // Decodes every value into the regular tree representation
+    BSONMap toBSONMap() const;
+
+private:
+    friend class LazyBuilder;
+    std::vector<LazyEntry> members;
+};
+
+// LazyDocument Class
+// Result of BSONParser::parseLazy: the skeleton of the document (sections
+// and keys) with undecoded value spans. Views the parsed buffer, which must
+// outlive it.
+class LazyDocument {
+public:
+    LazyDocument() : rootSection(std::make_shared<LazySection>()) {}
+
+    const LazySection& root() const { return *rootSection; }
+    const BSONValue* get(std::string_view key) const { return rootSection->get(key); }
+    const LazySection* section(std::string_view key) const { return rootSection->section(key); }
+    BSONMap toBSONMap() const { return rootSection->toBSONMap(); }
+
+private:
+    friend class LazyBuilder;
+    std::shared_ptr<LazySection> rootSection;
+};
+
+// LazyBuilder Class
+// BSONHandler that records the skeleton of a lazily lexed document.
+class LazyBuilder : public BSONHandler {
+public:
+    explicit LazyBuilder(LazyDocument& document);
+
+    bool onSectionOpen(std::string_view key, int level) override;
+    bool onSectionClose(int level) override;
+    bool onKey(std::string_view key) override;
+    bool onValue(const TokenView& value) override;
+    // Sorts the root once the parse is done; sections are sorted as they close
+    void finish();
+
+private:
+    std::vector<LazySection*> sections; // Open sections, root first
+    std::string_view pendingKey;
+};
@@ -0,0 +1,186 @@
+#include "BSONParser.hpp"
+#include "ThreadPool.hpp"
+#include "BSONArena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+// Chunks smaller than this are not worth a task of their own
+static const size_t kMinChunkSize = 64 * 1024;
+
+// findSectionStart
+// Position of the first line at or after from that opens a top-level
+// section, i.e. starts with "(o) " at column 0, or npos.
+static size_t findSectionStart(std::string_view content, size_t from) {
+    size_t found = content.find("\n(o) ", from - 1);
+    return found == std::string_view::npos ? found : found + 1;
+}
+
+// splitChunks
+// Cuts the document into chunks of at least target bytes, each starting at
+// a top-level section (except the first, which holds the header); a target
+// of 1 gives one chunk per section. A (o) line at column 0 resets the parser
+// to [root, section] whatever came before it, so every chunk parses on its
+// own exactly as it would as part of the whole. The one exception is a key
+// whose value is missing at the end of a chunk: it takes the next line as
+// its value, so run() is given the following chunk to report that error.
+std::vector<std::string_view> BSONParser::splitChunks(std::string_view content, size_t target) {
+    std::vector<std::string_view> chunks;
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t cut = start + target;
+        size_t next = cut < content.size() ? findSectionStart(content, cut) : std::string_view::npos;
+        if (next == std::string_view::npos) {
+            chunks.push_back(content.substr(start));
+            break;
+        }
+        chunks.push_back(content.substr(start, next - start));
+        start = next;
+    }
+    return chunks;
+}
+
+#ifdef BSON_STATS
+// addStats
+// Folds the statistics of one chunk into those of the whole document.
+static void addStats(BSONStats& total, const BSONStats& chunk) {
+    total.bytes += chunk.bytes;
+    total.lines += chunk.lines;
+    for (size_t t = 0; t <= TOKEN_ERROR; t++) total.tokens[t] += chunk.tokens[t];
+    for (size_t level = 0; level < 4; level++) total.sections[level] += chunk.sections[level];
+    total.maxArraySize = std::max(total.maxArraySize, chunk.maxArraySize);
+    total.lexNanos += chunk.lexNanos;
+    total.allocations += chunk.allocations;
+    total.peakBytes += chunk.peakBytes; // The chunks may have peaked at once
+}
+#endif
+
+// tryParseParallel
+// Parses each chunk into its own tree, then merges the top-level entries in
+// chunk order. Both a section and a key assign their name in the parent,
+// so inserting later chunks over earlier ones keeps last-writer-wins. The
+// first chunk that fails holds the error the serial parse would report.
+// The chunk parsers get this parser's interner and onSection hook; onParse
+// fires once, here, with the statistics of the chunks added up.
+BSONResult BSONParser::tryParseParallel(std::string_view content, ThreadPool& pool) {
+    size_t target = std::max(kMinChunkSize, content.size() / (size_t(pool.size()) * 4));
+    std::vector<std::string_view> chunks = splitChunks(content, target);
+    if (chunks.size() <= 1) return tryParse(content);
+    BSON_STAT(uint64_t start = bsonStatsNow());
+
+    struct ChunkResult {
+        BSONTreeBuilder builder;
+        BSONError error;
+        BSONStats stats;
+    };
+    std::vector<ChunkResult> results(chunks.size());
+    std::atomic<size_t> firstFailure{std::numeric_limits<size_t>::max()};
+
+    pool.parallelFor(chunks.size(), [&](size_t i) {
+        // Chunks after a failed one cannot change the outcome
+        if (i > firstFailure.load(std::memory_order_relaxed)) return;
+        BSONParser parser;
+        parser.interner = interner;
+        BSON_STAT(parser.hooks.onSection = hooks.onSection);
+        parser.run(chunks[i], results[i].builder, i > 0, i + 1 < chunks.size() ? chunks[i + 1] : std::string_view());
+        results[i].error = parser.failure;
+        BSON_STAT(results[i].stats = parser.parseStats);
+        if (parser.failure) {
+            size_t seen = firstFailure.load(std::memory_order_relaxed);
+            while (i < seen && !firstFailure.compare_exchange_weak(seen, i, std::memory_order_relaxed)) {}
+        }
+    });
+
+    BSONResult result;
+    failure = BSONError();
+    BSON_STAT(parseStats = BSONStats();
+              for (const ChunkResult& chunk : results) addStats(parseStats, chunk.stats);
+              parseStats.parseNanos = bsonStatsNow() - start;
+              result.stats = parseStats;
+              if (hooks.onParse) hooks.onParse(parseStats));
+    size_t failed = firstFailure.load();
+    if (failed < chunks.size()) {
+        // Chunk lines count from 1; shift them to document lines
+        failure = results[failed].error;
+        size_t offset = static_cast<size_t>(chunks[failed].data() - content.data());
+        failure.line += static_cast<int>(std::count(content.begin(), content.begin() + offset, '\n'));
+        result.error = failure;
+        return result;
+    }
+
+    for (size_t i = 0; i < chunks.size(); i++) {
+        BSONMap& chunk = *results[i].builder.root();
+        if (i == 0) {
+            result.value = std::move(chunk);
+            continue;
+        }
+        for (auto& entry : chunk) {
+            result.value.insert_or_assign(entry.first, std::move(entry.second));
+        }
+    }
+    return result;
+}
+
+// parseParallel
+// Throwing wrappers around tryParseParallel, like parse().
+BSONMap BSONParser::parseParallel(std::string_view content, ThreadPool& pool) {
+    BSONResult result = tryParseParallel(content, pool);
+    if (!result.ok()) throw std::runtime_error(result.error.message());
+    return std::move(result.value);
+}
+
+BSONMap BSONParser::parseParallel(std::string_view content, unsigned threads) {
+    ThreadPool pool(threads);
+    return parseParallel(content, pool);
+}
+
+// parseMany
+// One parser per pool thread, indexed by the thread running the call, so no
+// parser is ever used by two threads at once. Each result has its own slot.
+std::vector<BSONResult> BSONParser::parseMany(const std::vector<std::string_view>& documents, ThreadPool& pool) {
+    std::vector<BSONParser> parsers(pool.size());
+    for (BSONParser& parser : parsers) {
+        parser.interner = interner;
+        parser.hooks = hooks;
+    }
+    std::vector<BSONResult> results(documents.size());
+    pool.parallelFor(documents.size(), [&](size_t i, unsigned thread) {
+        results[i] = parsers[thread].tryParse(documents[i]);
+    });
+    return results;
+}
+
+std::vector<BSONResult> BSONParser::parseMany(const std::vector<std::string_view>& documents, unsigned threads) {
+    ThreadPool pool(threads);
+    return parseMany(documents, pool);
+}
+
+// parseMany (arena)
+// Every worker cycles its own document and builder through reset / parse /
+// finish, like a single parser reused for a stream of small messages.
+std::vector<BSONError> BSONParser::parseMany(const std::vector<std::string_view>& documents, ThreadPool& pool,
+                                             const std::function<void(size_t, const ArenaDocument&)>& visit) {
+    struct Worker {
+        BSONParser parser;
+        ArenaDocument document;
+        ArenaBuilder builder;
+        Worker(BSONKeyInterner* keys, const BSONStatsHooks& hooks) : builder(document, ArenaOptions(), keys != nullptr) {
+            parser.interner = keys;
+            parser.hooks = hooks;
+        }
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned t = 0; t < pool.size(); t++) workers.push_back(std::make_unique<Worker>(interner, hooks));
+
+    std::vector<BSONError> errors(documents.size());
+    pool.parallelFor(documents.size(), [&](size_t i, unsigned thread) {
+        Worker& worker = *workers[thread];
+        worker.document.reset();
+        worker.builder.reset();
+        errors[i] = worker.parser.tryParse(documents[i], worker.builder);
+        if (errors[i]) return;
+        worker.builder.finish();
+        visit(i, worker.document);
+    });
+    return errors;
+}
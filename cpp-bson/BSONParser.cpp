@@ -3,50 +3,122 @@
 #include <iostream>
 #include <algorithm>
 
-// Error messages
-const std::string ERR_SYNTAX = "It hurt itself in its confusion!";
-const std::string ERR_INDENTATION = "The attack missed!";
-const std::string ERR_TYPE = "Target is immune!";
-const std::string ERR_BADGES = "Not enough badges!";
+BSONParser::BSONParser() : currentLevel(0) {
+    BSON_STAT(lexer.setStats(&parseStats));
+}
 
-BSONParser::BSONParser() : currentLevel(0) {}
+void BSONParser::reset() {
+    BSON_STAT(parseStats = BSONStats(); openSections.clear());
+    lexer.reset(std::string_view());
+    stack.clear();
+    stack.push_back({0});
+    currentLevel = 0;
+    failure = BSONError();
+    awaitingValue = false;
+}
 
 // parse
-// The core method that orchestrates the parsing process.
-// It uses a stack to manage the hierarchical structure of the BSON document.
+// Builds the full BSONMap tree by feeding the event-driven parser
+// into a BSONTreeBuilder.
 BSONMap BSONParser::parse(const std::string& content) {
-    // Step 1: Lexical Analysis
-    // Delegate the tokenization to the Lexer class.
-    Lexer lexer(content);
-    std::vector<Token> tokens = lexer.tokenize();
-
-    // Step 2: Parsing
-    // Initialize the root map and the stack.
-    auto root = std::make_shared<BSONMap>();
-    stack.clear();
-    stack.push_back({root, 0});
-    currentLevel = 0;
+    BSONTreeBuilder builder;
+    parse(std::string_view(content), builder);
+    return builder.take();
+}
 
-    size_t i = 0;
-    while (i < tokens.size()) {
-        Token token = tokens[i];
+std::shared_ptr<BSONMap> BSONParser::parseShared(std::string_view content) {
+    BSONTreeBuilder builder;
+    parse(content, builder);
+    return builder.root();
+}
 
-        if (token.type == TOKEN_EOF) break;
+// parse (event-driven)
+// Throwing wrapper around run(): invalid input raises std::runtime_error
+// carrying the spec's message.
+bool BSONParser::parse(std::string_view content, BSONHandler& handler) {
+    bool finished = run(content, handler);
+    if (failure) throw std::runtime_error(failure.message());
+    return finished;
+}
 
-        if (token.type == TOKEN_HEADER) {
-            i++;
-            continue;
-        }
+// tryParse
+// Non-throwing variants: the outcome is reported as a BSONError holding the
+// spec error code and the line it was found on.
+BSONResult BSONParser::tryParse(std::string_view content) {
+    BSONTreeBuilder builder;
+    BSONResult result;
+    run(content, builder);
+    result.error = failure;
+    BSON_STAT(result.stats = parseStats);
+    if (!failure) result.value = builder.take();
+    return result;
+}
 
-        // We look for INDENT tokens to determine structure
-        if (token.type == TOKEN_INDENT) {
-            Token indentToken = token;
-            i++; // Consume INDENT
+BSONError BSONParser::tryParse(std::string_view content, BSONHandler& handler) {
+    run(content, handler);
+    return failure;
+}
 
-            if (i >= tokens.size()) break;
-            Token nextToken = tokens[i];
+// run
+// The core method that orchestrates the parsing process.
+// Returns true if the whole input was consumed, false if the handler stopped
+// the parse or the input is invalid (failure then says why). Never throws.
+// With headerRead, content is a chunk from the middle of a document; next
+// is the chunk that follows it, if any.
+bool BSONParser::run(std::string_view content, BSONHandler& handler, bool headerRead, std::string_view next) {
+    begin(content, headerRead);
+    bool finished = consume(handler);
+    // A value still due runs into the next chunk's first line, as it would
+    // in the whole document: the error is that line's
+    if (finished && awaitingValue && !next.empty()) {
+        size_t end = next.find('\n');
+        lexer.resume(next.substr(0, end == std::string_view::npos ? end : end + 1));
+        finished = consume(handler);
+    }
+    finished = finished && close(handler);
+    BSON_STAT(endStats());
+    return finished;
+}
+
+// begin
+// Step 1: Lexical Analysis
+// Delegate the tokenization to the Lexer class.
+// The lexer views the caller's buffer instead of copying it.
+void BSONParser::begin(std::string_view content, bool headerRead) {
+    reset();
+    BSON_STAT(statsStart = bsonStatsNow(); allocMark = bsonStatsAllocBegin());
+    lexer.reset(content);
+    if (headerRead) lexer.skipHeader();
+    lexer.setKeyInterner(interner);
+    lexer.setLazyValues(lazyValues);
+}
+
+// consume
+// Step 2: Parsing
+// It uses a stack to manage the hierarchical structure of the BSON document.
+// Tokens are pulled from the lexer one at a time, so the token stream is
+// never materialized; each line is reported to the handler as soon as it
+// has been lexed and validated. Runs until the lexer's buffer is exhausted;
+// all state lives in members, so a pushed parse (see BSONStream.hpp) can
+// hand the lexer the next lines and call it again.
+bool BSONParser::consume(BSONHandler& handler) {
+    // A key whose value is missing takes the next token as its value, which
+    // may only arrive with the next buffer
+    if (awaitingValue) {
+        TokenView value = lexer.next();
+        if (value.type == TOKEN_EOF) return true;
+        awaitingValue = false;
+        if (!parseValue(value, handler)) return false;
+    }
 
-            int expectedLevel = indentToken.level;
+    for (TokenView token = lexer.next(); token.type != TOKEN_EOF; token = lexer.next()) {
+        if (token.type == TOKEN_ERROR) return fail(lexer.error().code, lexer.error().line);
+        if (token.type == TOKEN_HEADER) continue;
+
+        // We look for INDENT tokens to determine structure
+        if (token.type == TOKEN_INDENT) {
+            int expectedLevel = token.level;
+            TokenView nextToken = lexer.next();
 
             // Handle Section Header (Evolution)
             if (nextToken.type == TOKEN_SECTION_OPEN) {
@@ -54,41 +126,35 @@ BSONMap BSONParser::parse(const std::string& content) {
 
                 // Hierarchy Check: Evolution must be sequential (1 -> 2 -> 3)
                 if (expectedLevel != headerLevel - 1) {
-                    throw std::runtime_error(ERR_INDENTATION);
+                    return fail(BSON_ERR_INDENTATION, nextToken.line);
                 }
                 // Ensure we have enough badges (parent sections) to evolve
-                if (stack.size() < headerLevel) {
-                    throw std::runtime_error(ERR_BADGES);
+                if (stack.size() < static_cast<size_t>(headerLevel)) {
+                    return fail(BSON_ERR_BADGES, nextToken.line);
                 }
 
-                i++; // Consume SECTION_OPEN
-                if (i >= tokens.size() || tokens[i].type != TOKEN_IDENTIFIER) {
-                    throw std::runtime_error(ERR_SYNTAX);
+                TokenView keyToken = lexer.next();
+                if (keyToken.type != TOKEN_IDENTIFIER) {
+                    return fail(BSON_ERR_SYNTAX, keyToken.line);
                 }
-                Token keyToken = tokens[i];
-                validateKey(keyToken.literal);
-                i++; // Consume IDENTIFIER
+                if (!validateKey(keyToken)) return false;
 
-                if (i >= tokens.size() || tokens[i].type != TOKEN_SECTION_CLOSE) {
-                    throw std::runtime_error(ERR_SYNTAX);
+                TokenView closeToken = lexer.next();
+                if (closeToken.type != TOKEN_SECTION_CLOSE) {
+                    return fail(BSON_ERR_SYNTAX, closeToken.line);
                 }
-                i++; // Consume SECTION_CLOSE
 
                 // Pop stack to the correct parent level
                 // This handles dedenting implicitly by resizing the stack
-                while (stack.size() > headerLevel) {
-                    stack.pop_back();
-                }
-
-                // Create new section and add to parent
-                auto newMap = std::make_shared<BSONMap>();
-                BSONValue val(newMap);
-                auto parentMap = stack.back().map;
-                (*parentMap)[keyToken.literal] = val;
+                if (!popTo(headerLevel, handler)) return false;
 
                 // Push new section to stack as the current context
-                stack.push_back({newMap, headerLevel});
+                stack.push_back({headerLevel});
                 currentLevel = headerLevel;
+                BSON_STAT(parseStats.sections[headerLevel]++;
+                          if (hooks.onSection) openSections.push_back({std::string(keyToken.literal), bsonStatsNow()});
+                          else openSections.push_back({{}, 0}));
+                if (!handler.onSectionOpen(keyToken.literal, headerLevel)) return false;
                 continue;
             }
 
@@ -98,86 +164,181 @@ BSONMap BSONParser::parse(const std::string& content) {
                 if (expectedLevel != currentLevel) {
                     if (expectedLevel < currentLevel) {
                         // Dedent: Pop stack until we reach the expected level
-                        while (stack.size() > expectedLevel + 1) {
-                            stack.pop_back();
-                        }
+                        if (!popTo(expectedLevel + 1, handler)) return false;
                         currentLevel = expectedLevel;
                     } else {
                         // Cannot indent deeper without a section header
-                        throw std::runtime_error(ERR_INDENTATION);
+                        return fail(BSON_ERR_INDENTATION, nextToken.line);
                     }
                 }
 
-                Token keyToken = nextToken;
-                validateKey(keyToken.literal);
-                i++; // Consume IDENTIFIER
+                TokenView keyToken = nextToken;
+                if (!validateKey(keyToken)) return false;
 
-                if (i >= tokens.size() || tokens[i].type != TOKEN_VINE_WHIP) {
-                    throw std::runtime_error(ERR_SYNTAX);
+                TokenView whipToken = lexer.next();
+                if (whipToken.type != TOKEN_VINE_WHIP) {
+                    return fail(BSON_ERR_SYNTAX, whipToken.line);
                 }
-                i++; // Consume VINE_WHIP
 
                 // Parse Value
-                BSONValue val = parseValueFromTokens(tokens, i);
-                auto currentMap = stack.back().map;
-                (*currentMap)[keyToken.literal] = val;
+                if (!handler.onKey(keyToken.literal)) return false;
+                TokenView value = lexer.next();
+                if (value.type == TOKEN_EOF) {
+                    awaitingValue = true;
+                    return true;
+                }
+                if (!parseValue(value, handler)) return false;
                 continue;
             }
 
-            throw std::runtime_error(ERR_SYNTAX);
+            return fail(BSON_ERR_SYNTAX, nextToken.line);
         }
-        i++;
     }
 
-    return *root;
+    return true;
 }
 
-// parseValueFromTokens
-// Helper method to parse values from the token stream.
-BSONValue BSONParser::parseValueFromTokens(const std::vector<Token>& tokens, size_t& i) {
-    if (i >= tokens.size()) throw std::runtime_error(ERR_SYNTAX);
-    Token token = tokens[i];
-    i++;
+// close
+// Ends the input: a value still missing is a type error at the last line,
+// and whatever sections are still open are closed.
+bool BSONParser::close(BSONHandler& handler) {
+    if (awaitingValue) {
+        awaitingValue = false;
+        return parseValue(lexer.next(), handler);
+    }
+    return popTo(1, handler);
+}
 
+// endStats
+// Completes the statistics once the input has been consumed or rejected.
+void BSONParser::endStats() {
+    parseStats.parseNanos = bsonStatsNow() - statsStart;
+    bsonStatsAllocEnd(allocMark, parseStats);
+    if (hooks.onParse) hooks.onParse(parseStats);
+}
+
+// parseValue
+// Helper method to report a value starting at the given token,
+// pulling any further tokens (array elements) from the lexer.
+bool BSONParser::parseValue(const TokenView& token, BSONHandler& handler) {
     switch (token.type) {
-        case TOKEN_STRING: return BSONValue(token.literal);
-        case TOKEN_NUMBER: {
-            try {
-                size_t pos;
-                int v = std::stoi(token.literal, &pos);
-                if (pos == token.literal.length()) return BSONValue(v);
-            } catch (...) {}
-            try {
-                return BSONValue(std::stod(token.literal));
-            } catch (...) {}
-            throw std::runtime_error(ERR_TYPE);
-        }
-        case TOKEN_BOOL: return BSONValue(token.literal == "true");
-        case TOKEN_NULL: return BSONValue();
+        case TOKEN_STRING:
+        case TOKEN_NUMBER:
+        case TOKEN_BOOL:
+        case TOKEN_NULL:
+        case TOKEN_RAW_VALUE:
+            return handler.onValue(token);
         case TOKEN_ARRAY_START: {
-            BSONArray arr;
-            while (i < tokens.size()) {
-                if (tokens[i].type == TOKEN_ARRAY_END) {
-                    i++;
-                    return BSONValue(arr);
-                }
-                if (tokens[i].type == TOKEN_COMMA) {
-                    i++;
-                    continue;
+            if (!handler.onArrayStart()) return false;
+            BSON_STAT(size_t elements = 0);
+            for (TokenView element = lexer.next(); ; element = lexer.next()) {
+                if (element.type == TOKEN_ARRAY_END) {
+                    BSON_STAT(parseStats.maxArraySize = std::max(parseStats.maxArraySize, elements));
+                    return handler.onArrayEnd();
                 }
+                if (element.type == TOKEN_COMMA) continue;
+                BSON_STAT(elements++);
                 // Recursive call for array elements
-                arr.push_back(parseValueFromTokens(tokens, i));
+                if (!parseValue(element, handler)) return false;
             }
-            throw std::runtime_error(ERR_SYNTAX);
         }
-        default: throw std::runtime_error(ERR_TYPE);
+        // A missing value runs into the next line, which may not even lex
+        case TOKEN_ERROR: return fail(lexer.error().code, lexer.error().line);
+        default: return fail(BSON_ERR_TYPE, token.line);
     }
 }
 
-void BSONParser::validateKey(const std::string& key) {
-    if (key == "Charizard") throw std::runtime_error("It burns the bulb");
+// popTo
+// Pops the stack down to the given depth, closing each section on the way.
+bool BSONParser::popTo(size_t depth, BSONHandler& handler) {
+    while (stack.size() > depth) {
+        int level = stack.back().level;
+        BSON_STAT(const OpenSection& open = openSections.back();
+                  if (hooks.onSection) hooks.onSection(open.name, level, bsonStatsNow() - open.start);
+                  openSections.pop_back());
+        stack.pop_back();
+        if (!handler.onSectionClose(level)) return false;
+    }
+    return true;
+}
+
+bool BSONParser::validateKey(const TokenView& key) {
+    if (key.literal == "Charizard") return fail(BSON_ERR_CHARIZARD, key.line);
+    return true;
+}
+
+// fail
+// Records the first error of the parse; always returns false.
+bool BSONParser::fail(BSONErrorCode code, int line) {
+    failure = {code, line};
+    return false;
+}
+
+
+// Implementation of BSONTreeBuilder
+
+BSONTreeBuilder::BSONTreeBuilder() : rootMap(std::make_shared<BSONMap>()) {
+    sections.push_back(rootMap);
+}
+
+bool BSONTreeBuilder::onSectionOpen(std::string_view key, int /*level*/) {
+    // Create new section and add to parent
+    auto newMap = std::make_shared<BSONMap>();
+    sections.back()->insert_or_assign(std::string(key), BSONValue(newMap));
+    sections.push_back(std::move(newMap));
+    return true;
 }
 
+bool BSONTreeBuilder::onSectionClose(int /*level*/) {
+    sections.pop_back();
+    return true;
+}
+
+bool BSONTreeBuilder::onKey(std::string_view name) {
+    pendingKey.assign(name.data(), name.size());
+    return true;
+}
+
+bool BSONTreeBuilder::onValue(const TokenView& value) {
+    switch (value.type) {
+        case TOKEN_STRING: store(BSONValue(std::string(value.literal))); return true;
+        case TOKEN_NUMBER: store(value.isFloat ? BSONValue(value.floatValue) : BSONValue(value.intValue)); return true;
+        case TOKEN_BOOL: store(BSONValue(value.literal == "true")); return true;
+        default: store(BSONValue()); return true;
+    }
+}
+
+bool BSONTreeBuilder::onArrayStart() {
+    arrays.emplace_back();
+    return true;
+}
+
+bool BSONTreeBuilder::onArrayEnd() {
+    BSONArray arr = std::move(arrays.back());
+    arrays.pop_back();
+    store(BSONValue(std::move(arr)));
+    return true;
+}
+
+// store
+// Moves a finished value into the enclosing array, or under the pending key.
+void BSONTreeBuilder::store(BSONValue&& val) {
+    if (!arrays.empty()) {
+        arrays.back().push_back(std::move(val));
+        return;
+    }
+    sections.back()->insert_or_assign(pendingKey, std::move(val));
+}
+
+bool operator==(const BSONValue& a, const BSONValue& b) {
+    if (a.type != b.type) return false;
+    if (a.type == BSONValue::OBJECT) {
+        const auto& x = std::get<std::shared_ptr<BSONMap>>(a.value);
+        const auto& y = std::get<std::shared_ptr<BSONMap>>(b.value);
+        return x == y || (x && y && *x == *y);
+    }
+    return a.value == b.value;
+}
 
 // Implementation of print methods
 
@@ -185,7 +346,7 @@ void printAST(const BSONMap& map) {
     for (const auto& pair : map) {
         std::cout << pair.first << ": ";
         if (pair.second.type == BSONValue::OBJECT || pair.second.type == BSONValue::ARRAY) {
-            std::cout << std::endl;
+            std::cout << '\n';
             pair.second.print(1);
         } else {
             pair.second.print(0);
@@ -199,22 +360,22 @@ void BSONValue::print(int indent) const {
     std::visit([&](auto&& arg) {
         using T = std::decay_t<decltype(arg)>;
         if constexpr (std::is_same_v<T, std::string>) {
-            if (indent == 0) std::cout << arg << std::endl;
-            else std::cout << indentation << arg << std::endl;
+            if (indent == 0) std::cout << arg << '\n';
+            else std::cout << indentation << arg << '\n';
         } else if constexpr (std::is_same_v<T, int> || std::is_same_v<T, double>) {
-            if (indent == 0) std::cout << arg << std::endl;
-            else std::cout << indentation << arg << std::endl;
+            if (indent == 0) std::cout << arg << '\n';
+            else std::cout << indentation << arg << '\n';
         } else if constexpr (std::is_same_v<T, bool>) {
-            if (indent == 0) std::cout << (arg ? "true" : "false") << std::endl;
-            else std::cout << indentation << (arg ? "true" : "false") << std::endl;
+            if (indent == 0) std::cout << (arg ? "true" : "false") << '\n';
+            else std::cout << indentation << (arg ? "true" : "false") << '\n';
         } else if constexpr (std::is_same_v<T, std::monostate>) {
-            if (indent == 0) std::cout << "null" << std::endl;
-            else std::cout << indentation << "null" << std::endl;
+            if (indent == 0) std::cout << "null" << '\n';
+            else std::cout << indentation << "null" << '\n';
         } else if constexpr (std::is_same_v<T, BSONArray>) {
             for (const auto& val : arg) {
                 std::cout << indentation << "- ";
                 if (val.type == OBJECT || val.type == ARRAY) {
-                    std::cout << std::endl;
+                    std::cout << '\n';
                     val.print(indent + 1);
                 } else {
                     val.print(0);
@@ -224,7 +385,7 @@ void BSONValue::print(int indent) const {
             for (const auto& pair : *arg) {
                 std::cout << indentation << pair.first << ": ";
                 if (pair.second.type == OBJECT || pair.second.type == ARRAY) {
-                    std::cout << std::endl;
+                    std::cout << '\n';
                     pair.second.print(indent + 1);
                 } else {
                     pair.second.print(0);
@@ -1,11 +1,14 @@
 #pragma once
 #include <string>
+#include <functional>
 #include <map>
 #include <vector>
 #include <variant>
 #include <memory>
 #include <stdexcept>
 #include "Lexer.hpp"
+#include "BSONHandler.hpp"
+#include "BSONStats.hpp"
 
 // BSONValue structure to hold various types supported by BSON
 struct BSONValue;
@@ -26,42 +29,194 @@ struct BSONValue {
     std::variant<std::string, int, double, bool, std::monostate, BSONArray, std::shared_ptr<BSONMap>> value;
 
     BSONValue() : type(NULL_TYPE), value(std::monostate{}) {}
-    BSONValue(std::string v) : type(STRING), value(v) {}
+    // Sink constructors: pass temporaries (or std::move) so large strings
+    // and arrays are moved into the variant rather than copied
+    BSONValue(std::string v) : type(STRING), value(std::move(v)) {}
     BSONValue(const char* v) : type(STRING), value(std::string(v)) {}
     BSONValue(int v) : type(INT), value(v) {}
     BSONValue(double v) : type(FLOAT), value(v) {}
     BSONValue(bool v) : type(BOOL), value(v) {}
-    BSONValue(BSONArray v) : type(ARRAY), value(v) {}
-    BSONValue(std::shared_ptr<BSONMap> v) : type(OBJECT), value(v) {}
+    BSONValue(BSONArray v) : type(ARRAY), value(std::move(v)) {}
+    BSONValue(std::shared_ptr<BSONMap> v) : type(OBJECT), value(std::move(v)) {}
 
     // Print method to display the value recursively
     void print(int indent = 0) const;
 };
 
+// Deep equality: sections compare by content, not by pointer
+bool operator==(const BSONValue& a, const BSONValue& b);
+inline bool operator!=(const BSONValue& a, const BSONValue& b) { return !(a == b); }
+
 // Function to print the entire AST
 void printAST(const BSONMap& map);
 
+// BSONTreeBuilder Class
+// BSONHandler that materializes the event stream into a BSONMap tree.
+// This is what BSONParser::parse(const std::string&) uses internally.
+class BSONTreeBuilder : public BSONHandler {
+public:
+    BSONTreeBuilder();
+
+    bool onSectionOpen(std::string_view key, int level) override;
+    bool onSectionClose(int level) override;
+    bool onKey(std::string_view key) override;
+    bool onValue(const TokenView& value) override;
+    bool onArrayStart() override;
+    bool onArrayEnd() override;
+
+    std::shared_ptr<BSONMap> root() const { return rootMap; }
+    // Moves the finished document out; the builder is left empty
+    BSONMap take() { return std::move(*rootMap); }
+
+private:
+    std::shared_ptr<BSONMap> rootMap;
+    std::vector<std::shared_ptr<BSONMap>> sections; // Open sections, root first
+    std::vector<BSONArray> arrays;                  // Arrays under construction
+    std::string pendingKey;                         // Key awaiting its value
+
+    void store(BSONValue&& val);
+};
+
+// BSONResult Structure
+// Outcome of BSONParser::tryParse: the document, or the error that stopped it.
+struct BSONResult {
+    BSONMap value;
+    BSONError error;
+    BSONStats stats; // See BSONParser::stats(); zero for parallel parses
+
+    bool ok() const { return !error; }
+};
+
 // BSONParser Class
 // Implements the parsing logic using Object-Oriented Principles.
 // Encapsulates the state of the parsing process (stack, current level).
+class ArenaDocument;
+class LazyDocument;
+struct ArenaOptions;
+class BSONTape;
+class ThreadPool;
+
 class BSONParser {
 public:
     BSONParser();
     // Main parse method
     BSONMap parse(const std::string& content);
+    // Same, but hands back the root the parse built instead of moving it
+    // into a new map; sections can then be shared without any copy.
+    std::shared_ptr<BSONMap> parseShared(std::string_view content);
+    // Parses a file straight from a read-only memory mapping of it
+    // (see MappedFile.hpp). Throws if the file cannot be opened.
+    BSONMap parseFile(const std::string& path);
+    // Parses into a single arena that owns every node, key and string
+    // (see BSONArena.hpp; include it to use the result).
+    ArenaDocument parseArena(std::string_view content);
+    ArenaDocument parseArena(std::string_view content, const ArenaOptions& options);
+    // Parses into a flat tape of tagged 64-bit entries
+    // (see BSONTape.hpp; include it to use the result).
+    BSONTape parseTape(std::string_view content);
+    // Records only sections, keys and the source span of each value; values
+    // are decoded on first access (see BSONLazy.hpp). The content buffer
+    // must outlive the document.
+    LazyDocument parseLazy(std::string_view content);
+    // Event-driven parse: reports the document to the handler as it is read.
+    // Returns false if the handler stopped the parse early.
+    bool parse(std::string_view content, BSONHandler& handler);
+
+    // Non-throwing parse: never throws on any input. The result carries the
+    // spec error code and line number on failure.
+    BSONResult tryParse(std::string_view content);
+    // Non-throwing event-driven parse; BSON_OK if the input was valid (or the
+    // handler stopped before reaching an error).
+    BSONError tryParse(std::string_view content, BSONHandler& handler);
+
+    // Parallel parse: splits the document at top-level (o) sections, parses
+    // the chunks on the pool and merges them into the root in document
+    // order. Same result and errors as parse() (see ThreadPool.hpp). The
+    // chunk parsers share this parser's interner, which must then be
+    // thread-safe, and may call the onSection hook concurrently.
+    BSONMap parseParallel(std::string_view content, ThreadPool& pool);
+    // Same, on a temporary pool; 0 threads means one per hardware thread
+    BSONMap parseParallel(std::string_view content, unsigned threads = 0);
+    BSONResult tryParseParallel(std::string_view content, ThreadPool& pool);
+
+    // Batch parse: spreads whole documents over the pool, every worker
+    // thread reusing one parser of its own for the whole batch. Results come
+    // back in input order, each with its own error, so an invalid document
+    // does not affect the others. Never throws on invalid input. An interner
+    // set on this parser is shared by the workers and must be thread-safe.
+    std::vector<BSONResult> parseMany(const std::vector<std::string_view>& documents, ThreadPool& pool);
+    std::vector<BSONResult> parseMany(const std::vector<std::string_view>& documents, unsigned threads = 0);
+    // Arena variant: each worker also reuses one ArenaDocument, so once its
+    // buffers have grown the batch allocates nothing per document.
+    // visit(i, document) runs on the worker as soon as document i has parsed
+    // and may only use the document during the call; it must not throw. It
+    // is not called for invalid documents. Returns every document's error.
+    std::vector<BSONError> parseMany(const std::vector<std::string_view>& documents, ThreadPool& pool,
+                                     const std::function<void(size_t, const ArenaDocument&)>& visit);
+
+    // Shares an interner with the lexer: keys reported to handlers are then
+    // interned, and parseArena stores them without copying (the interner
+    // must outlive the documents). Pass nullptr to stop interning.
+    void setKeyInterner(BSONKeyInterner* keys) { interner = keys; }
+
+    // The error of the most recent parse, if any
+    const BSONError& error() const { return failure; }
+    // Statistics of the most recent parse; all zero unless the library is
+    // built with BSON_STATS (see BSONStats.hpp). A parallel parse adds up
+    // those of its chunks (peakBytes then bounds the peak from above);
+    // parseMany gives each result its own.
+    const BSONStats& stats() const { return parseStats; }
+    // Callbacks for every later parse, in BSON_STATS builds. parseMany
+    // hands them to its workers, which may call them concurrently.
+    void setStatsHooks(BSONStatsHooks newHooks) { hooks = std::move(newHooks); }
+    // The line being parsed; during a handler callback, the line the event
+    // comes from
+    int line() const { return lexer.line(); }
+
+    // Forgets the previous parse but keeps the lexer's buffers and the
+    // stack's capacity. Every parse starts with it, so a parser kept around
+    // for many small inputs stops allocating for itself after the first few.
+    void reset();
 
 private:
     // Context for the stack to track nesting
     // OOP Concept: Encapsulation of state
     struct Context {
-        std::shared_ptr<BSONMap> map;
-        int level; // 0=Root, 1=Bulb, 2=Ivysaur, 3=Venusaur
+        int level;            // 0=Root, 1=Bulb, 2=Ivysaur, 3=Venusaur
     };
 
+    Lexer lexer; // Reused by every parse
     std::vector<Context> stack;
     int currentLevel;
+    BSONError failure;
+    BSONKeyInterner* interner = nullptr;
+    bool lazyValues = false; // Values reach the handler as TOKEN_RAW_VALUE
+    bool awaitingValue = false; // The buffer ended right after a vine whip
+    BSONStats parseStats;
+    BSONStatsHooks hooks;
+    uint64_t statsStart = 0;
+    BSONAllocMark allocMark;
+    // Each section on the stack, for hooks.onSection. The name is a copy
+    // (only taken when that hook is set): the section may stay open after
+    // its line is gone, e.g. across BSONStreamParser::feed
+    struct OpenSection {
+        std::string name;
+        uint64_t start;
+    };
+    std::vector<OpenSection> openSections;
 
     // Helper methods
-    BSONValue parseValueFromTokens(const std::vector<Token>& tokens, size_t& i);
-    void validateKey(const std::string& key);
+    bool run(std::string_view content, BSONHandler& handler, bool headerRead = false, std::string_view next = {});
+    void begin(std::string_view content, bool headerRead);
+    bool consume(BSONHandler& handler);
+    bool close(BSONHandler& handler);
+    void endStats();
+    bool parseValue(const TokenView& token, BSONHandler& handler);
+    bool popTo(size_t depth, BSONHandler& handler);
+    bool validateKey(const TokenView& key);
+    bool fail(BSONErrorCode code, int line);
+    static std::vector<std::string_view> splitChunks(std::string_view content, size_t target);
+
+    friend class BSONIncrementalParser;
+    friend class BSONStreamParser;
 };
@@ -0,0 +1,130 @@
+#include "BSONPath.hpp"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+BSONPath::BSONPath(std::string_view path) {
+    size_t start = 0;
+    while (true) {
+        size_t dot = path.find('.', start);
+        std::string_view key = path.substr(start, dot == std::string_view::npos ? std::string_view::npos : dot - start);
+        bool valid = !key.empty();
+        for (char c : key) {
+            valid = valid && (std::isalnum(static_cast<unsigned char>(c)) || c == '_');
+        }
+        if (!valid) throw std::runtime_error("Invalid path: " + std::string(path));
+        parts.push_back({std::string(key), std::hash<std::string_view>()(key)});
+        if (dot == std::string_view::npos) break;
+        start = dot + 1;
+    }
+}
+
+const BSONValue* BSONPath::evaluate(const BSONMap& document) const {
+    const BSONMap* map = &document;
+    for (size_t i = 0; i < parts.size(); i++) {
+        auto it = map->find(parts[i].key);
+        if (it == map->end()) return nullptr;
+        if (i + 1 == parts.size()) return &it->second;
+        if (it->second.type != BSONValue::OBJECT) return nullptr;
+        map = std::get<std::shared_ptr<BSONMap>>(it->second.value).get();
+    }
+    return nullptr;
+}
+
+const ArenaValue* BSONPath::evaluate(const ArenaDocument& document) const {
+    const ArenaMap* map = &document.root();
+    for (size_t i = 0; i < parts.size(); i++) {
+        const ArenaValue* value = map->find(parts[i].key, parts[i].hash);
+        if (!value || i + 1 == parts.size()) return value;
+        if (value->type != BSONValue::OBJECT) return nullptr;
+        map = value->map;
+    }
+    return nullptr;
+}
+
+std::optional<BSONValue> BSONPath::find(std::string_view content) const {
+    BSONParser parser;
+    BSONPathMatcher matcher(*this);
+    parser.parse(content, matcher);
+    if (!matcher.found()) return std::nullopt;
+    return matcher.value();
+}
+
+// Implementation of BSONPathMatcher
+// Sections nest strictly (the parser closes deeper ones before opening a
+// sibling), so the path only has to be matched along the chain of open
+// sections: matchedDepth counts how many of them, from the root, it names.
+
+bool BSONPathMatcher::matches(size_t segment, std::string_view key) const {
+    return segment < path.segments().size() && path.segments()[segment].key == key;
+}
+
+const BSONValue& BSONPathMatcher::value() const {
+    return capture.root()->at(capturedKey);
+}
+
+bool BSONPathMatcher::onSectionOpen(std::string_view key, int level) {
+    openDepth = static_cast<size_t>(level);
+    if (captureDepth != 0) return capture.onSectionOpen(key, level);
+
+    if (matchedDepth == openDepth - 1 && matches(openDepth - 1, key)) {
+        matchedDepth = openDepth;
+        // The path ends at this section: capture all of it
+        if (openDepth == path.segments().size()) {
+            captureDepth = openDepth;
+            capturedKey = std::string(key);
+            return capture.onSectionOpen(key, level);
+        }
+    }
+    return true;
+}
+
+bool BSONPathMatcher::onSectionClose(int level) {
+    if (captureDepth != 0) {
+        capture.onSectionClose(level);
+        if (openDepth == captureDepth) {
+            done = true;
+            return false;
+        }
+    }
+    openDepth--;
+    matchedDepth = std::min(matchedDepth, openDepth);
+    return true;
+}
+
+bool BSONPathMatcher::onKey(std::string_view key) {
+    if (captureDepth != 0) return capture.onKey(key);
+    if (matchedDepth == openDepth && openDepth + 1 == path.segments().size() && matches(openDepth, key)) {
+        capturingValue = true;
+        capturedKey = std::string(key);
+        capture.onKey(key);
+    }
+    return true;
+}
+
+bool BSONPathMatcher::onValue(const TokenView& value) {
+    if (captureDepth == 0 && !capturingValue) return true;
+    capture.onValue(value);
+    if (capturingValue && arrayDepth == 0) {
+        done = true;
+        return false;
+    }
+    return true;
+}
+
+bool BSONPathMatcher::onArrayStart() {
+    if (captureDepth == 0 && !capturingValue) return true;
+    arrayDepth++;
+    return capture.onArrayStart();
+}
+
+bool BSONPathMatcher::onArrayEnd() {
+    if (captureDepth == 0 && !capturingValue) return true;
+    arrayDepth--;
+    capture.onArrayEnd();
+    if (capturingValue && arrayDepth == 0) {
+        done = true;
+        return false;
+    }
+    return true;
+}
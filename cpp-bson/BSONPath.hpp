@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BSONParser.hpp"
+#include "BSONArena.hpp"
+
+// BSONPath Class
+// A compiled selector such as "database.pool.max_connections": section
+// names down to a key (or to a section). The path is split and every key
+// hashed once, then evaluated any number of times against documents.
+// Throws std::runtime_error if a segment is empty or not a valid key.
+class BSONPath {
+public:
+    struct Segment {
+        std::string key;
+        size_t hash; // std::hash<std::string_view>, as used by ArenaMap
+    };
+
+    explicit BSONPath(std::string_view path);
+
+    const std::vector<Segment>& segments() const { return parts; }
+
+    // The selected value in a parsed document, or nullptr
+    const BSONValue* evaluate(const BSONMap& document) const;
+    // The selected value in an arena document, or nullptr; hashed sections
+    // are probed with the precomputed hashes
+    const ArenaValue* evaluate(const ArenaDocument& document) const;
+
+    // Streams content through the parser and stops as soon as the selected
+    // value has been read, so the rest of the input is never lexed. This is
+    // the first occurrence: a later duplicate key or section that a full
+    // parse would keep is not seen. Throws on a parse error before the match.
+    std::optional<BSONValue> find(std::string_view content) const;
+
+private:
+    std::vector<Segment> parts;
+};
+
+// BSONPathMatcher Class
+// BSONHandler that follows a BSONPath through the event stream, captures
+// the selected value (a whole section if the path ends at one) and then
+// stops the parse by returning false.
+class BSONPathMatcher : public BSONHandler {
+public:
+    explicit BSONPathMatcher(const BSONPath& path) : path(path) {}
+
+    bool onSectionOpen(std::string_view key, int level) override;
+    bool onSectionClose(int level) override;
+    bool onKey(std::string_view key) override;
+    bool onValue(const TokenView& value) override;
+    bool onArrayStart() override;
+    bool onArrayEnd() override;
+
+    bool found() const { return done; }
+    // The captured value; valid once found()
+    const BSONValue& value() const;
+
+private:
+    const BSONPath& path;
+    size_t openDepth = 0;    // Sections open below the root
+    size_t matchedDepth = 0; // How many of those follow the path
+    size_t captureDepth = 0; // Depth of the section being captured, or 0
+    bool capturingValue = false;
+    int arrayDepth = 0;
+    bool done = false;
+    BSONTreeBuilder capture;
+    std::string capturedKey;
+
+    bool matches(size_t segment, std::string_view key) const;
+};
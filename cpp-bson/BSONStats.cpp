@@ -0,0 +1,54 @@
+#include "BSONStats.hpp"
+#include <algorithm>
+
+#ifdef BSON_STATS
+
+// Allocation counting
+// Fed by the allocator (see BSONStatsAlloc.cpp). The counters are per
+// thread: a block freed by another thread than the one that allocated it
+// moves bytes between their counts, which is why they are signed.
+namespace {
+
+thread_local size_t allocationCount = 0;
+thread_local std::ptrdiff_t liveBytes = 0;
+thread_local std::ptrdiff_t peakBytes = 0;
+
+} // namespace
+
+void bsonStatsCountAllocation(size_t size) {
+    allocationCount++;
+    liveBytes += static_cast<std::ptrdiff_t>(size);
+    peakBytes = std::max(peakBytes, liveBytes);
+}
+
+void bsonStatsCountRelease(size_t size) { liveBytes -= static_cast<std::ptrdiff_t>(size); }
+
+bool bsonStatsEnabled() { return true; }
+
+// The peak restarts from the live bytes for every parse and is merged back
+// into the enclosing parse's afterwards
+BSONAllocMark bsonStatsAllocBegin() {
+    BSONAllocMark mark{allocationCount, liveBytes, peakBytes};
+    peakBytes = liveBytes;
+    return mark;
+}
+
+void bsonStatsAllocEnd(const BSONAllocMark& mark, BSONStats& stats) {
+    stats.allocations = allocationCount - mark.allocations;
+    stats.peakBytes = static_cast<size_t>(std::max<std::ptrdiff_t>(peakBytes - mark.liveBytes, 0));
+    peakBytes = std::max(peakBytes, mark.outerPeak);
+}
+
+#else
+
+bool bsonStatsEnabled() { return false; }
+
+void bsonStatsCountAllocation(size_t) {}
+
+void bsonStatsCountRelease(size_t) {}
+
+BSONAllocMark bsonStatsAllocBegin() { return {}; }
+
+void bsonStatsAllocEnd(const BSONAllocMark&, BSONStats&) {}
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include "Lexer.hpp"
+
+// BSON_STATS
+// Define it for every file of the build (-DBSON_STATS) to gather parse
+// statistics. Without it each hook compiles to nothing: the statistics stay
+// zero and the callbacks never fire, at no cost to the parse.
+#ifdef BSON_STATS
+#define BSON_STAT(...) __VA_ARGS__
+#else
+#define BSON_STAT(...)
+#endif
+
+// BSONStats Structure
+// What one parse went through, to find out why a document is slow to load.
+// Filled by BSONParser for its own parses (see BSONParser::stats()); a Lexer
+// used on its own fills the lexing part (see Lexer::setStats).
+struct BSONStats {
+    size_t bytes = 0;                    // Input handed to the lexer
+    size_t lines = 0;                    // Lines lexed, blank lines and comments included
+    size_t tokens[TOKEN_ERROR + 1] = {}; // Tokens lexed, by TokenType
+    size_t sections[4] = {};             // Sections opened, by level (1-3); [0] is unused
+    size_t maxArraySize = 0;             // Elements of the largest array (not in lazy mode)
+    uint64_t lexNanos = 0;               // Time spent lexing lines
+    uint64_t parseNanos = 0;             // The whole parse: lexing and the handler included
+    // Allocations only count if the application feeds them in (see
+    // bsonStatsCountAllocation); they stay zero otherwise
+    size_t allocations = 0;              // operator new calls on the parsing thread
+    size_t peakBytes = 0;                // Peak allocated on the parsing thread, over what was live at the start
+};
+
+// BSONStatsHooks Structure
+// Optional callbacks to feed a metrics pipeline (see
+// BSONParser::setStatsHooks). They run on the parsing thread, in the middle
+// of the parse, and must not throw.
+struct BSONStatsHooks {
+    // The parse has ended, successfully or not; stats are final
+    std::function<void(const BSONStats& stats)> onParse;
+    // A section has closed after nanos spent in it, subsections included
+    std::function<void(std::string_view key, int level, uint64_t nanos)> onSection;
+};
+
+// Whether the library was built with BSON_STATS
+bool bsonStatsEnabled();
+
+// Monotonic clock for the timings, in nanoseconds
+inline uint64_t bsonStatsNow() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+// Allocation counting
+// The library never replaces operator new itself. An application links
+// BSONStatsAlloc.cpp to have the global operator new and delete count every
+// allocation, or calls these from its own allocator. Counts are per thread;
+// the calls do nothing without BSON_STATS.
+void bsonStatsCountAllocation(size_t size);
+void bsonStatsCountRelease(size_t size);
+
+// BSONAllocMark Structure
+// The calling thread's allocation counters when a parse started; parses on
+// one thread may nest.
+struct BSONAllocMark {
+    size_t allocations = 0;
+    std::ptrdiff_t liveBytes = 0;
+    std::ptrdiff_t outerPeak = 0; // Peak of the enclosing parse, if any
+};
+
+BSONAllocMark bsonStatsAllocBegin();
+void bsonStatsAllocEnd(const BSONAllocMark& mark, BSONStats& stats);
@@ -0,0 +1,78 @@
+// Allocation counting for BSON_STATS builds
+// Replaces the global operator new and delete of the whole program, so it is
+// not part of the library: link it into the application on purpose to fill
+// BSONStats::allocations and peakBytes. Leave it out of programs that have
+// their own allocator (jemalloc, tcmalloc, a custom operator new) and call
+// bsonStatsCountAllocation / bsonStatsCountRelease from that one instead.
+// Without BSON_STATS this file is empty.
+
+#include "BSONStats.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef BSON_STATS
+
+// A header in front of every block records its size, so the live bytes
+// can be tracked without sized deallocation.
+namespace {
+
+const size_t kHeader = alignof(std::max_align_t);
+
+void* allocate(size_t size, size_t alignment) {
+    size_t header = std::max(kHeader, alignment);
+    void* block;
+    if (alignment <= kHeader) {
+        block = std::malloc(size + header);
+    } else {
+        // aligned_alloc wants a multiple of the alignment
+        block = std::aligned_alloc(alignment, (size + header + alignment - 1) / alignment * alignment);
+    }
+    if (!block) return nullptr;
+    char* data = static_cast<char*>(block) + header;
+    reinterpret_cast<size_t*>(data)[-1] = size;
+    bsonStatsCountAllocation(size);
+    return data;
+}
+
+void* allocateOrThrow(size_t size, size_t alignment) {
+    void* data = allocate(size, alignment);
+    if (!data) throw std::bad_alloc();
+    return data;
+}
+
+void release(void* data, size_t alignment) {
+    if (!data) return;
+    bsonStatsCountRelease(reinterpret_cast<size_t*>(data)[-1]);
+    std::free(static_cast<char*>(data) - std::max(kHeader, alignment));
+}
+
+} // namespace
+
+void* operator new(size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t a) { return allocateOrThrow(size, static_cast<size_t>(a)); }
+void* operator new[](size_t size, std::align_val_t a) { return allocateOrThrow(size, static_cast<size_t>(a)); }
+void* operator new(size_t size, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(a));
+}
+void* operator new[](size_t size, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(a));
+}
+
+void operator delete(void* p) noexcept { release(p, 0); }
+void operator delete[](void* p) noexcept { release(p, 0); }
+void operator delete(void* p, size_t) noexcept { release(p, 0); }
+void operator delete[](void* p, size_t) noexcept { release(p, 0); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p, 0); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p, 0); }
+void operator delete(void* p, std::align_val_t a) noexcept { release(p, static_cast<size_t>(a)); }
+void operator delete[](void* p, std::align_val_t a) noexcept { release(p, static_cast<size_t>(a)); }
+void operator delete(void* p, size_t, std::align_val_t a) noexcept { release(p, static_cast<size_t>(a)); }
+void operator delete[](void* p, size_t, std::align_val_t a) noexcept { release(p, static_cast<size_t>(a)); }
+void operator delete(void* p, std::align_val_t a, const std::nothrow_t&) noexcept { release(p, static_cast<size_t>(a)); }
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept { release(p, static_cast<size_t>(a)); }
+
+#endif
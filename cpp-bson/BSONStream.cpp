@@ -0,0 +1,92 @@
+#include "BSONStream.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Size of the reads made by feed(std::istream&) and feedFd
+static const size_t kReadSize = 64 * 1024;
+
+BSONStreamParser::BSONStreamParser(BSONHandler& handler) : handler(handler) {}
+
+BSONStreamParser::BSONStreamParser() : tree(std::make_unique<BSONTreeBuilder>()), handler(*tree) {}
+
+// feed
+// Complete lines are lexed straight from the caller's chunk; only a line
+// split across chunks is reassembled in carry.
+bool BSONStreamParser::feed(std::string_view chunk) {
+    if (stopped) return false;
+    if (!carry.empty()) {
+        size_t newline = chunk.find('\n');
+        if (newline == std::string_view::npos) {
+            carry.append(chunk);
+            return true;
+        }
+        carry.append(chunk.substr(0, newline + 1));
+        chunk.remove_prefix(newline + 1);
+        if (!parseLines(carry)) return false;
+        carry.clear();
+    }
+    size_t last = chunk.rfind('\n');
+    if (last != std::string_view::npos) {
+        if (!parseLines(chunk.substr(0, last + 1))) return false;
+        chunk.remove_prefix(last + 1);
+    }
+    carry.assign(chunk.data(), chunk.size());
+    return true;
+}
+
+bool BSONStreamParser::feed(std::istream& in) {
+    std::string block(kReadSize, '\0');
+    while (in) {
+        in.read(&block[0], static_cast<std::streamsize>(block.size()));
+        if (!feed(std::string_view(block.data(), static_cast<size_t>(in.gcount())))) return false;
+    }
+    return true;
+}
+
+bool BSONStreamParser::feedFd(int fd) {
+    std::string block(kReadSize, '\0');
+    while (true) {
+#ifdef _WIN32
+        int got = _read(fd, &block[0], static_cast<unsigned>(block.size()));
+#else
+        ssize_t got = ::read(fd, &block[0], block.size());
+#endif
+        if (got < 0) throw std::runtime_error("Cannot read BSON input");
+        if (got == 0) return true;
+        if (!feed(std::string_view(block.data(), static_cast<size_t>(got)))) return false;
+    }
+}
+
+bool BSONStreamParser::finish() {
+    if (stopped) return false;
+    if (!carry.empty() && !parseLines(carry)) return false;
+    carry.clear();
+    if (!started) parser.begin(std::string_view(), false);
+    stopped = true;
+    bool finished = parser.close(handler);
+    BSON_STAT(parser.endStats());
+    return finished;
+}
+
+// parseLines
+// Hands whole lines to the parser, which picks up where the previous ones
+// left it: same stack, same line numbers, possibly a value still due.
+bool BSONStreamParser::parseLines(std::string_view lines) {
+    if (!started) {
+        parser.begin(lines, false);
+        started = true;
+    } else {
+        parser.lexer.resume(lines);
+    }
+    if (!parser.consume(handler)) {
+        stopped = true;
+        BSON_STAT(parser.endStats());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "BSONParser.hpp"
+
+// BSONStreamParser Class
+// Push-style parser for input that arrives in pieces, e.g. from a socket or
+// a pipe: feed() takes chunks of any size, split anywhere, and every line
+// they complete is parsed and reported right away. Only the unfinished last
+// line is copied and kept between chunks, so memory stays bounded by the
+// longest line plus the section stack (and whatever the handler keeps).
+// Events and errors are exactly those of BSONParser::parse on the whole
+// input. Never throws on invalid input.
+class BSONStreamParser {
+public:
+    // Reports events to handler, which must outlive the parser. Views passed
+    // to it are only valid during the callback.
+    explicit BSONStreamParser(BSONHandler& handler);
+    // Builds the document instead; see document()
+    BSONStreamParser();
+
+    BSONStreamParser(const BSONStreamParser&) = delete;
+    BSONStreamParser& operator=(const BSONStreamParser&) = delete;
+
+    // Parses the lines chunk completes. Returns false once the input is
+    // invalid (error() says why) or the handler stopped the parse; further
+    // input is then ignored.
+    bool feed(std::string_view chunk);
+    // Feeds everything up to the end of the stream, in 64 KiB reads
+    bool feed(std::istream& in);
+    // Same, reading a file descriptor until end of file.
+    // Throws std::runtime_error if a read fails.
+    bool feedFd(int fd);
+    // Ends the input: parses the last line, which may lack its newline, and
+    // closes the open sections. Returns whether the whole input was valid.
+    bool finish();
+
+    const BSONError& error() const { return parser.error(); }
+    // Statistics of the parse, in BSON_STATS builds (see BSONStats.hpp),
+    // final once finish() has returned or the parse has stopped. Time and
+    // allocations run from the first chunk on, waits between chunks included.
+    const BSONStats& stats() const { return parser.stats(); }
+    void setStatsHooks(BSONStatsHooks hooks) { parser.setStatsHooks(std::move(hooks)); }
+    // Bytes of the unfinished line held back for the next chunk
+    size_t buffered() const { return carry.size(); }
+    // The document built so far, by the default constructor; complete once
+    // finish() succeeded
+    BSONMap& document() { return *tree->root(); }
+
+private:
+    BSONParser parser;
+    std::unique_ptr<BSONTreeBuilder> tree;
+    BSONHandler& handler;
+    std::string carry; // Start of a line whose newline has not arrived
+    bool started = false;
+    bool stopped = false;
+
+    bool parseLines(std::string_view lines);
+};
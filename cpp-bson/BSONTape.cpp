@@ -0,0 +1,217 @@
+#include "BSONTape.hpp"
+#include <cstring>
+
+// Implementation of BSONTape
+
+BSONTape::BSONTape() {
+    // An empty document: just the root start and end
+    tape.push_back(entry('r', 2));
+    tape.push_back(entry('R', 0));
+}
+
+std::string_view BSONTape::stringAt(size_t i) const {
+    size_t offset = payloadAt(i);
+    uint32_t length;
+    std::memcpy(&length, strings.data() + offset, sizeof(length));
+    return std::string_view(strings.data() + offset + sizeof(length), length);
+}
+
+// skip
+// Returns the index of the entry following the value that starts at i.
+size_t BSONTape::skip(size_t i) const {
+    switch (tagAt(i)) {
+        case 'r': case '{': case '[': return payloadAt(i);
+        case 'd': return i + 2;
+        default: return i + 1;
+    }
+}
+
+uint64_t BSONTape::addString(std::string_view s) {
+    uint64_t offset = strings.size();
+    uint32_t length = static_cast<uint32_t>(s.size());
+    strings.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    strings.append(s.data(), s.size());
+    return offset;
+}
+
+// Implementation of TapeRef
+
+BSONValue::Type TapeRef::type() const {
+    switch (tape->tagAt(index)) {
+        case 's': return BSONValue::STRING;
+        case 'i': return BSONValue::INT;
+        case 'd': return BSONValue::FLOAT;
+        case 't': case 'f': return BSONValue::BOOL;
+        case '[': return BSONValue::ARRAY;
+        case 'r': case '{': return BSONValue::OBJECT;
+        default: return BSONValue::NULL_TYPE;
+    }
+}
+
+std::string_view TapeRef::asString() const { return tape->stringAt(index); }
+
+int TapeRef::asInt() const { return static_cast<int32_t>(static_cast<uint32_t>(tape->payloadAt(index))); }
+
+double TapeRef::asFloat() const {
+    double v;
+    std::memcpy(&v, &tape->tape[index + 1], sizeof(v));
+    return v;
+}
+
+bool TapeRef::asBool() const { return tape->tagAt(index) == 't'; }
+
+size_t TapeRef::size() const {
+    size_t count = 0;
+    for (Iterator it = begin(), last = end(); it != last; ++it) count++;
+    return count;
+}
+
+TapeRef TapeRef::operator[](size_t position) const {
+    for (Iterator it = begin(), last = end(); it != last; ++it) {
+        if (position-- == 0) return (*it).value;
+    }
+    return TapeRef();
+}
+
+TapeRef TapeRef::find(std::string_view key) const {
+    TapeRef found;
+    if (type() != BSONValue::OBJECT) return found;
+    for (Iterator it = begin(), last = end(); it != last; ++it) {
+        TapeField field = *it;
+        if (field.key == key) found = field.value;
+    }
+    return found;
+}
+
+TapeRef::Iterator TapeRef::begin() const {
+    char tag = tape->tagAt(index);
+    return Iterator(tape, index + 1, tag != '[');
+}
+
+TapeRef::Iterator TapeRef::end() const {
+    char tag = tape->tagAt(index);
+    // Scalars have no children: begin() == end()
+    if (tag != 'r' && tag != '{' && tag != '[') return begin();
+    return Iterator(tape, tape->payloadAt(index) - 1, tag != '[');
+}
+
+TapeField TapeRef::Iterator::operator*() const {
+    if (!keyed) return {std::string_view(), TapeRef(tape, index)};
+    return {tape->stringAt(index), TapeRef(tape, index + 1)};
+}
+
+TapeRef::Iterator& TapeRef::Iterator::operator++() {
+    index = keyed ? tape->skip(index + 1) : tape->skip(index);
+    return *this;
+}
+
+BSONValue TapeRef::toBSONValue() const {
+    switch (type()) {
+        case BSONValue::STRING: return BSONValue(std::string(asString()));
+        case BSONValue::INT: return BSONValue(asInt());
+        case BSONValue::FLOAT: return BSONValue(asFloat());
+        case BSONValue::BOOL: return BSONValue(asBool());
+        case BSONValue::ARRAY: {
+            BSONArray arr;
+            for (TapeField field : *this) arr.push_back(field.value.toBSONValue());
+            return BSONValue(arr);
+        }
+        case BSONValue::OBJECT: {
+            auto map = std::make_shared<BSONMap>();
+            for (TapeField field : *this) (*map)[std::string(field.key)] = field.value.toBSONValue();
+            return BSONValue(map);
+        }
+        default: return BSONValue();
+    }
+}
+
+// parseTape
+// Same grammar as parse(), but the document is laid out on a BSONTape.
+BSONTape BSONParser::parseTape(std::string_view content) {
+    BSONTape tape;
+    TapeBuilder builder(tape);
+    parse(content, builder);
+    builder.finish();
+    return tape;
+}
+
+// Implementation of TapeBuilder
+
+TapeBuilder::TapeBuilder(BSONTape& tape) : tape(tape) {
+    // Reopen the root so members can be appended before its end entry
+    t().clear();
+    tape.strings.clear();
+    t().push_back(BSONTape::entry('r', 0));
+    open.push_back(0);
+}
+
+bool TapeBuilder::onSectionOpen(std::string_view key, int /*level*/) {
+    onKey(key);
+    openContainer('{');
+    return true;
+}
+
+bool TapeBuilder::onSectionClose(int /*level*/) {
+    closeContainer('}');
+    return true;
+}
+
+bool TapeBuilder::onKey(std::string_view key) {
+    t().push_back(BSONTape::entry('k', tape.addString(key)));
+    return true;
+}
+
+bool TapeBuilder::onValue(const TokenView& value) {
+    switch (value.type) {
+        case TOKEN_STRING:
+            t().push_back(BSONTape::entry('s', tape.addString(value.literal)));
+            break;
+        case TOKEN_NUMBER: {
+            if (!value.isFloat) {
+                t().push_back(BSONTape::entry('i', static_cast<uint32_t>(value.intValue)));
+            } else {
+                uint64_t bits;
+                std::memcpy(&bits, &value.floatValue, sizeof(bits));
+                t().push_back(BSONTape::entry('d', 0));
+                t().push_back(bits);
+            }
+            break;
+        }
+        case TOKEN_BOOL:
+            t().push_back(BSONTape::entry(value.literal == "true" ? 't' : 'f', 0));
+            break;
+        default:
+            t().push_back(BSONTape::entry('n', 0));
+            break;
+    }
+    return true;
+}
+
+bool TapeBuilder::onArrayStart() {
+    openContainer('[');
+    return true;
+}
+
+bool TapeBuilder::onArrayEnd() {
+    closeContainer(']');
+    return true;
+}
+
+void TapeBuilder::finish() {
+    closeContainer('R');
+}
+
+void TapeBuilder::openContainer(char tag) {
+    open.push_back(t().size());
+    t().push_back(BSONTape::entry(tag, 0));
+}
+
+// closeContainer
+// Appends the end entry and back-patches the start with the skip offset.
+void TapeBuilder::closeContainer(char tag) {
+    size_t start = open.back();
+    open.pop_back();
+    t().push_back(BSONTape::entry(tag, start));
+    char startTag = tape.tagAt(start);
+    t()[start] = BSONTape::entry(startTag, t().size());
+}
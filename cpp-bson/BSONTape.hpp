@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BSONParser.hpp"
+
+class BSONTape;
+struct TapeField;
+
+// TapeRef Class
+// Read-only handle to one value on a BSONTape. Mirrors the BSONValue API,
+// but every access is an index into the tape instead of a pointer chase.
+// An invalid ref (e.g. a key that was not found) tests false.
+class TapeRef {
+public:
+    TapeRef() = default;
+    TapeRef(const BSONTape* tape, size_t index) : tape(tape), index(index) {}
+
+    explicit operator bool() const { return tape != nullptr; }
+
+    BSONValue::Type type() const;
+    std::string_view asString() const;
+    int asInt() const;
+    double asFloat() const;
+    bool asBool() const;
+
+    // Sections and arrays: number of members / elements (a linear walk)
+    size_t size() const;
+    // Arrays: the element at the given position
+    TapeRef operator[](size_t position) const;
+    // Sections: the value stored under key, or an invalid ref.
+    // Duplicate keys resolve to the last occurrence, like BSONMap.
+    TapeRef find(std::string_view key) const;
+
+    // Deep-copies the value into the regular BSONValue representation
+    BSONValue toBSONValue() const;
+
+    // Walks the children of a section or array in document order
+    class Iterator {
+    public:
+        Iterator(const BSONTape* tape, size_t index, bool keyed) : tape(tape), index(index), keyed(keyed) {}
+        TapeField operator*() const;
+        Iterator& operator++();
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+    private:
+        const BSONTape* tape;
+        size_t index;
+        bool keyed;
+    };
+
+    Iterator begin() const;
+    Iterator end() const;
+
+private:
+    const BSONTape* tape = nullptr;
+    size_t index = 0;
+};
+
+// TapeField Structure
+// One child of a section (key + value) or an array (empty key).
+struct TapeField {
+    std::string_view key;
+    TapeRef value;
+};
+
+// BSONTape Class
+// Flat document layout: one contiguous array of tagged 64-bit entries, with
+// string payloads in a side buffer. The top byte of an entry is its tag, the
+// low 56 bits its payload:
+//
+//   'r' / 'R'   root start / end          (start holds the index past the end)
+//   '{' / '}'   section start / end       (start holds the index past the end)
+//   '[' / ']'   array start / end         (start holds the index past the end)
+//   'k'         key                       (offset into the string buffer)
+//   's'         string                    (offset into the string buffer)
+//   'i'         int                       (the value itself)
+//   'd'         double                    (raw bits in the following entry)
+//   't' 'f' 'n' SuperEffective, NotVeryEffective, MissingNo
+//
+// Sections are sequences of key, value pairs. Strings in the side buffer are
+// a 32-bit length followed by the bytes.
+class BSONTape {
+public:
+    BSONTape();
+
+    TapeRef root() const { return TapeRef(this, 0); }
+    TapeRef find(std::string_view key) const { return root().find(key); }
+
+    const std::vector<uint64_t>& entries() const { return tape; }
+
+private:
+    friend class TapeRef;
+    friend class TapeBuilder;
+
+    std::vector<uint64_t> tape;
+    std::string strings;
+
+    static uint64_t entry(char tag, uint64_t payload) { return (uint64_t(uint8_t(tag)) << 56) | payload; }
+    char tagAt(size_t i) const { return char(tape[i] >> 56); }
+    uint64_t payloadAt(size_t i) const { return tape[i] & ((uint64_t(1) << 56) - 1); }
+    std::string_view stringAt(size_t i) const;
+    size_t skip(size_t i) const;
+    uint64_t addString(std::string_view s);
+};
+
+// TapeBuilder Class
+// BSONHandler that appends the event stream to a BSONTape.
+// Container starts are back-patched with their skip offset when they close.
+class TapeBuilder : public BSONHandler {
+public:
+    explicit TapeBuilder(BSONTape& tape);
+
+    bool onSectionOpen(std::string_view key, int level) override;
+    bool onSectionClose(int level) override;
+    bool onKey(std::string_view key) override;
+    bool onValue(const TokenView& value) override;
+    bool onArrayStart() override;
+    bool onArrayEnd() override;
+
+    // Closes the root; call once the parse has finished
+    void finish();
+
+private:
+    BSONTape& tape;
+    std::vector<size_t> open; // Tape indices of the open containers
+    std::vector<uint64_t>& t() { return tape.tape; }
+
+    void openContainer(char tag);
+    void closeContainer(char tag);
+};
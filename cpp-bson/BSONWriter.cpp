@@ -0,0 +1,183 @@
+#include "BSONWriter.hpp"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Buffered sinks are written out once this much is pending
+static const size_t kFlushThreshold = 64 * 1024;
+
+// Evolution markers by section level
+static const char* const kMarkers[] = {"", "(o)", "(O)", "(@)"};
+
+BSONWriter::BSONWriter(std::string& out) : sink(STRING), target(&out) {}
+
+BSONWriter::BSONWriter(FILE* file) : sink(FILE_SINK), file(file) {}
+
+BSONWriter::BSONWriter(int fd) : sink(FD), fd(fd) {}
+
+BSONWriter::~BSONWriter() {
+    // Destructors must not throw; write errors are the caller's to check
+    // with an explicit flush()
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+void BSONWriter::write(const BSONMap& document) {
+    out() += "BULBA!\n";
+    writeSection(document, 0);
+    maybeFlush();
+}
+
+void BSONWriter::flush() {
+    if (sink == STRING || buffer.empty()) return;
+    const char* data = buffer.data();
+    size_t remaining = buffer.size();
+    if (sink == FILE_SINK) {
+        if (std::fwrite(data, 1, remaining, file) != remaining) throw std::runtime_error("Cannot write BSON output");
+    } else {
+        while (remaining > 0) {
+#ifdef _WIN32
+            int written = _write(fd, data, static_cast<unsigned>(remaining));
+#else
+            ssize_t written = ::write(fd, data, remaining);
+#endif
+            if (written <= 0) throw std::runtime_error("Cannot write BSON output");
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+    }
+    buffer.clear();
+}
+
+void BSONWriter::maybeFlush() {
+    if (sink != STRING && buffer.size() >= kFlushThreshold) flush();
+}
+
+// writeSection
+// Plain members come first and subsections after them, so no line ever
+// depends on a dedent to return to its section.
+void BSONWriter::writeSection(const BSONMap& map, int level) {
+    for (const auto& entry : map) {
+        if (entry.second.type == BSONValue::OBJECT) continue;
+        indent(level);
+        writeKey(entry.first, false);
+        out() += " ~> ";
+        writeValue(entry.second, false);
+        out() += '\n';
+        maybeFlush();
+    }
+    for (const auto& entry : map) {
+        if (entry.second.type != BSONValue::OBJECT) continue;
+        if (level == 3) throw std::runtime_error("Cannot write BSON: sections nest deeper than (@)");
+        int child = level + 1;
+        indent(level);
+        out() += kMarkers[child];
+        out() += ' ';
+        writeKey(entry.first, true);
+        out() += ' ';
+        out() += kMarkers[child];
+        out() += '\n';
+        writeSection(*std::get<std::shared_ptr<BSONMap>>(entry.second.value), child);
+    }
+}
+
+// writeKey
+// Keys of values must be identifiers; section names are only delimited by
+// their markers, so they just have to stay on one line.
+void BSONWriter::writeKey(const std::string& key, bool section) {
+    bool valid = key != "Charizard" && key.find_first_of("\r\n") == std::string::npos && key.find("zZz") == std::string::npos;
+    if (!section) {
+        valid = valid && !key.empty();
+        for (char c : key) {
+            valid = valid && (std::isalnum(static_cast<unsigned char>(c)) || c == '_');
+        }
+    }
+    if (!valid) throw std::runtime_error("Cannot write BSON: invalid key \"" + key + "\"");
+    out() += key;
+}
+
+// endsArrayString
+// Inside an array, a quote followed by blanks and a comma (or "|>") ends
+// the string, and an opening quote followed by a comma is an element of
+// its own (see Lexer::arrayElementEnd): no such quote can be written.
+static bool endsArrayString(std::string_view s) {
+    size_t next = s.find_first_not_of(" \t");
+    if (next != std::string_view::npos && s[next] == ',') return true;
+    for (size_t quote = s.find('"'); quote != std::string_view::npos; quote = s.find('"', quote + 1)) {
+        next = s.find_first_not_of(" \t", quote + 1);
+        if (next != std::string_view::npos && (s[next] == ',' || s.compare(next, 2, "|>") == 0)) return true;
+    }
+    return false;
+}
+
+void BSONWriter::writeValue(const BSONValue& value, bool inArray) {
+    std::string& o = out();
+    switch (value.type) {
+        case BSONValue::STRING: {
+            const std::string& s = std::get<std::string>(value.value);
+            if (s.find_first_of("\r\n") != std::string::npos || s.find("zZz") != std::string::npos ||
+                (inArray && endsArrayString(s))) {
+                throw std::runtime_error("Cannot write BSON: string cannot be expressed");
+            }
+            o += '"';
+            o += s;
+            o += '"';
+            break;
+        }
+        case BSONValue::INT: {
+            char digits[16];
+            auto result = std::to_chars(digits, digits + sizeof digits, std::get<int>(value.value));
+            o.append(digits, result.ptr);
+            break;
+        }
+        case BSONValue::FLOAT: writeDouble(std::get<double>(value.value)); break;
+        case BSONValue::BOOL: o += std::get<bool>(value.value) ? "SuperEffective" : "NotVeryEffective"; break;
+        case BSONValue::NULL_TYPE: o += "MissingNo"; break;
+        case BSONValue::ARRAY: {
+            const BSONArray& arr = std::get<BSONArray>(value.value);
+            if (arr.empty()) {
+                o += "<||>";
+                break;
+            }
+            o += "<| ";
+            for (size_t i = 0; i < arr.size(); i++) {
+                if (i) o += ", ";
+                writeValue(arr[i], true);
+            }
+            o += " |>";
+            break;
+        }
+        case BSONValue::OBJECT: throw std::runtime_error("Cannot write BSON: sections cannot be array elements");
+    }
+}
+
+// writeDouble
+// Shortest round-trip form; integral values get ".0" so they read back as
+// floats rather than ints.
+void BSONWriter::writeDouble(double d) {
+    if (std::fpclassify(d) == FP_SUBNORMAL) throw std::runtime_error("Cannot write BSON: subnormal float");
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof digits, d);
+    std::string_view text(digits, static_cast<size_t>(result.ptr - digits));
+    out() += text;
+    if (text.find_first_of(".ein") == std::string_view::npos) out() += ".0";
+}
+
+void BSONWriter::indent(int level) {
+    out().append(static_cast<size_t>(level) * 4, ' ');
+}
+
+std::string toBSONString(const BSONMap& document) {
+    std::string out;
+    BSONWriter(out).write(document);
+    return out;
+}
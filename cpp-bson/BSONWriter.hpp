@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "BSONParser.hpp"
+
+// BSONWriter Class
+// Serializes a BSONMap back to BSON text: the header, "key ~> value" lines,
+// evolution markers for sections and <| |> arrays. Output is buffered and
+// written in large blocks (never flushed per line), into a std::string, a
+// FILE* or a file descriptor. Numbers are formatted with std::to_chars, so
+// parsing the output gives back exactly the same values.
+//
+// Values the format cannot express throw std::runtime_error: sections
+// nested deeper than (@) or inside arrays, invalid or forbidden keys,
+// strings holding line breaks or "zZz" (or, inside arrays, a quote that
+// would end the element) and subnormal floats, which the parser rejects.
+class BSONWriter {
+public:
+    explicit BSONWriter(std::string& out);
+    explicit BSONWriter(FILE* file);
+    explicit BSONWriter(int fd);
+    ~BSONWriter();
+
+    BSONWriter(const BSONWriter&) = delete;
+    BSONWriter& operator=(const BSONWriter&) = delete;
+
+    // Writes a whole document, header included
+    void write(const BSONMap& document);
+    // Writes a single value as it follows a vine whip; sections throw
+    void writeValue(const BSONValue& value) { writeValue(value, false); }
+    // Hands buffered output to the FILE* or descriptor
+    void flush();
+
+private:
+    enum Sink { STRING, FILE_SINK, FD };
+
+    Sink sink;
+    std::string* target = nullptr; // STRING: written to directly
+    FILE* file = nullptr;
+    int fd = -1;
+    std::string buffer;            // FILE_SINK / FD: pending output
+
+    std::string& out() { return sink == STRING ? *target : buffer; }
+    void maybeFlush();
+
+    void writeSection(const BSONMap& map, int level);
+    void writeKey(const std::string& key, bool section);
+    void writeValue(const BSONValue& value, bool inArray);
+    void writeDouble(double d);
+    void indent(int level);
+};
+
+// Serializes a document to a string
+std::string toBSONString(const BSONMap& document);
@@ -1,194 +1,464 @@
 #include "Lexer.hpp"
-#include <sstream>
-#include <regex>
+#include "BSONStats.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
 
-Lexer::Lexer(const std::string& content) : content(content) {}
+Lexer::Lexer(const std::string& content) : content(content), source(this->content), index(source) {}
+
+Lexer::Lexer(std::string_view content) : source(content), index(source) {}
+
+Lexer::Lexer(const char* content) : source(content), index(source) {}
+
+void Lexer::reset(std::string_view newSource) {
+    source = newSource;
+    index.reset(source);
+    BSON_STAT(if (stats) stats->bytes += source.size());
+    tokens.clear();
+    pos = 0;
+    lineNum = 0;
+    firstLine = true;
+    pending.clear();
+    pendingPos = 0;
+    failure = BSONError();
+}
+
+void Lexer::resume(std::string_view more) {
+    source = more;
+    index.reset(source);
+    BSON_STAT(if (stats) stats->bytes += source.size());
+    pos = 0;
+    pending.clear();
+    pendingPos = 0;
+}
 
 // tokenize
-// The main loop that processes the input line by line.
-// It handles high-level structure like headers, comments, and indentation.
+// Owning wrapper around tokenizeView: copies each literal into a Token.
 std::vector<Token> Lexer::tokenize() {
-    std::stringstream ss(content);
-    std::string line;
-    int lineNum = 0;
-    bool firstLine = true;
-
-    while (std::getline(ss, line)) {
-        lineNum++;
-        // Handle Windows-style line endings
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-
-        // Header Check: The Cry
-        if (firstLine) {
-            if (line != "BULBA!") {
-                throw std::runtime_error("Status: Fainted");
+    const std::vector<TokenView>& views = tokenizeView();
+    std::vector<Token> result;
+    result.reserve(views.size());
+    for (const TokenView& t : views) {
+        result.push_back({t.type, std::string(t.literal), t.line, t.level, t.isFloat, t.intValue, t.floatValue});
+    }
+    return result;
+}
+
+// tokenizeView
+// Drains next() into a vector for callers that want every token up front.
+const std::vector<TokenView>& Lexer::tokenizeView() {
+    tokens.clear();
+    TokenView token;
+    do {
+        token = next();
+        if (token.type == TOKEN_ERROR) throw std::runtime_error(failure.message());
+        tokens.push_back(token);
+    } while (token.type != TOKEN_EOF);
+    return tokens;
+}
+
+// next
+// Pull-based interface: returns one token at a time, lexing a new line only
+// when the tokens of the previous one have been handed out.
+// Once the input is exhausted it keeps returning TOKEN_EOF.
+// A line that fails to lex yields none of its tokens, only TOKEN_ERROR.
+TokenView Lexer::next() {
+    while (pendingPos == pending.size()) {
+        pending.clear();
+        pendingPos = 0;
+        if (failure) return {TOKEN_ERROR, "", failure.line, 0};
+        BSON_STAT(uint64_t lexStart = stats ? bsonStatsNow() : 0);
+        bool lexed = lexNextLine();
+        BSON_STAT(if (stats) {
+            stats->lexNanos += bsonStatsNow() - lexStart;
+            if (lexed) {
+                for (const TokenView& token : pending) stats->tokens[token.type]++;
             }
-            tokens.push_back({TOKEN_HEADER, "BULBA!", lineNum, 0});
-            firstLine = false;
-            continue;
+        })
+        if (!lexed) {
+            if (!failure) return {TOKEN_EOF, "", lineNum, 0};
+            pending.clear();
         }
+    }
+    return pending[pendingPos++];
+}
 
-        // Handle comments (Sleep Powder)
-        // We strip out comments before further processing.
-        size_t commentPos = line.find("zZz");
-        if (commentPos != std::string::npos) {
-            line = line.substr(0, commentPos);
-        }
+// fail
+// Records the error for the current line; always returns false.
+bool Lexer::fail(BSONErrorCode code) {
+    failure = {code, lineNum};
+    return false;
+}
 
-        // Trim right whitespace
-        line.erase(std::find_if(line.rbegin(), line.rend(), [](unsigned char ch) {
-            return !std::isspace(ch);
-        }).base(), line.end());
-
-        if (line.empty()) continue;
-
-        // Check indentation (Solar Beam Rule)
-        // We count spaces to determine the indentation level.
-        int indentCount = 0;
-        bool hasTab = false;
-        for (char c : line) {
-            if (c == ' ') indentCount++;
-            else if (c == '\t') { hasTab = true; break; }
-            else break;
-        }
+// lexNextLine
+// Processes the next line of the input into the pending token buffer.
+// It handles high-level structure like headers, comments, and indentation.
+// Lines are sliced out of the source buffer, so no line is ever copied.
+// Newlines, comments and indentation come from the structural index.
+// Returns false once there are no lines left or the line is invalid.
+bool Lexer::lexNextLine() {
+    if (pos >= source.size()) return false;
 
-        if (hasTab) throw std::runtime_error("Poison Type: Tab character detected");
-        if (indentCount % 4 != 0) throw std::runtime_error("The attack missed!");
+    size_t lineStart = pos;
+    size_t end = index.nextNewline(pos);
+    std::string_view line = source.substr(pos, end - pos);
+    pos = end + 1;
 
-        int level = indentCount / 4;
-        // Emit an INDENT token so the parser knows the nesting level of this line.
-        tokens.push_back({TOKEN_INDENT, "", lineNum, level});
+    lineNum++;
+    BSON_STAT(if (stats) stats->lines++);
+    // Handle Windows-style line endings
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
 
-        std::string trimmedLine = trim(line);
-        tokenizeLine(trimmedLine, lineNum);
+    // Header Check: The Cry
+    if (firstLine) {
+        if (line != "BULBA!") {
+            return fail(BSON_ERR_HEADER);
+        }
+        pending.push_back({TOKEN_HEADER, "BULBA!", lineNum, 0});
+        firstLine = false;
+        return true;
     }
-    
-    tokens.push_back({TOKEN_EOF, "", lineNum, 0});
-    return tokens;
+
+    // Handle comments (Sleep Powder)
+    // We strip out comments before further processing.
+    size_t commentPos = index.findComment(lineStart, lineStart + line.size());
+    if (commentPos != StructuralIndex::npos) {
+        line = line.substr(0, commentPos - lineStart);
+    }
+
+    // Trim right whitespace
+    while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+        line.remove_suffix(1);
+    }
+
+    if (line.empty()) return true;
+
+    // Check indentation (Solar Beam Rule)
+    // We count spaces to determine the indentation level.
+    size_t spaces = index.countSpaces(lineStart, lineStart + line.size());
+    int indentCount = static_cast<int>(spaces);
+    bool hasTab = spaces < line.size() && line[spaces] == '\t';
+
+    if (hasTab) return fail(BSON_ERR_TAB);
+    if (indentCount % 4 != 0) return fail(BSON_ERR_INDENTATION);
+
+    int level = indentCount / 4;
+    // Emit an INDENT token so the parser knows the nesting level of this line.
+    pending.push_back({TOKEN_INDENT, "", lineNum, level});
+
+    return tokenizeLine(trim(line), lineNum);
 }
 
 // tokenizeLine
 // Processes a single line after indentation has been handled.
 // Identifies Section Headers or Key-Value pairs.
-void Lexer::tokenizeLine(const std::string& line, int lineNum) {
+bool Lexer::tokenizeLine(std::string_view line, int lineNum) {
     // Section Headers (Evolution Stages)
     // We check for specific patterns like (o) ... (o)
     if (startsWith(line, "(o) ") && endsWith(line, " (o)")) {
-        tokens.push_back({TOKEN_SECTION_OPEN, "", lineNum, 1});
-        std::string key = line.substr(4, line.length() - 8);
-        tokens.push_back({TOKEN_IDENTIFIER, key, lineNum, 0});
-        tokens.push_back({TOKEN_SECTION_CLOSE, "", lineNum, 1});
-        return;
+        pending.push_back({TOKEN_SECTION_OPEN, "", lineNum, 1});
+        std::string_view key = line.substr(4, line.length() - 8);
+        pending.push_back({TOKEN_IDENTIFIER, identifier(key), lineNum, 0});
+        pending.push_back({TOKEN_SECTION_CLOSE, "", lineNum, 1});
+        return true;
     }
     if (startsWith(line, "(O) ") && endsWith(line, " (O)")) {
-        tokens.push_back({TOKEN_SECTION_OPEN, "", lineNum, 2});
-        std::string key = line.substr(4, line.length() - 8);
-        tokens.push_back({TOKEN_IDENTIFIER, key, lineNum, 0});
-        tokens.push_back({TOKEN_SECTION_CLOSE, "", lineNum, 2});
-        return;
+        pending.push_back({TOKEN_SECTION_OPEN, "", lineNum, 2});
+        std::string_view key = line.substr(4, line.length() - 8);
+        pending.push_back({TOKEN_IDENTIFIER, identifier(key), lineNum, 0});
+        pending.push_back({TOKEN_SECTION_CLOSE, "", lineNum, 2});
+        return true;
     }
     if (startsWith(line, "(@) ") && endsWith(line, " (@)")) {
-        tokens.push_back({TOKEN_SECTION_OPEN, "", lineNum, 3});
-        std::string key = line.substr(4, line.length() - 8);
-        tokens.push_back({TOKEN_IDENTIFIER, key, lineNum, 0});
-        tokens.push_back({TOKEN_SECTION_CLOSE, "", lineNum, 3});
-        return;
+        pending.push_back({TOKEN_SECTION_OPEN, "", lineNum, 3});
+        std::string_view key = line.substr(4, line.length() - 8);
+        pending.push_back({TOKEN_IDENTIFIER, identifier(key), lineNum, 0});
+        pending.push_back({TOKEN_SECTION_CLOSE, "", lineNum, 3});
+        return true;
     }
 
     // Key-Value Pairs
-    // We use Regex to capture the key, the vine whip, and the value.
-    std::regex re("^([a-zA-Z0-9_]+)\\s*(~{1,}>)\\s*(.*)$");
-    std::smatch matches;
-    if (std::regex_match(line, matches, re)) {
-        std::string key = matches[1];
-        std::string valStr = matches[3];
-        
-        tokens.push_back({TOKEN_IDENTIFIER, key, lineNum, 0});
-        tokens.push_back({TOKEN_VINE_WHIP, "", lineNum, 0});
-        tokenizeValue(valStr, lineNum);
-        return;
+    // A single scan captures the key, the vine whip, and the value.
+    size_t keyEnd, valueStart;
+    if (scanKeyValue(line, keyEnd, valueStart)) {
+        pending.push_back({TOKEN_IDENTIFIER, identifier(line.substr(0, keyEnd)), lineNum, 0});
+        pending.push_back({TOKEN_VINE_WHIP, "", lineNum, 0});
+        if (lazyValues) {
+            pending.push_back({TOKEN_RAW_VALUE, line.substr(valueStart), lineNum, 0});
+            return true;
+        }
+        return tokenizeValue(line.substr(valueStart), lineNum);
+    }
+
+    return fail(BSON_ERR_SYNTAX);
+}
+
+// identifier
+// The literal of an identifier token: the interned copy of the key when an
+// interner is set, otherwise the slice of the line.
+std::string_view Lexer::identifier(std::string_view key) {
+    return interner ? interner->intern(key).str() : key;
+}
+
+// lexValue
+// Decodes a value deferred in lazy mode, reusing the regular value rules.
+// An empty value is a type error here: in a full parse it would have
+// swallowed the next line's first token as its value and failed on that.
+bool Lexer::lexValue(std::string_view value, int line, std::vector<TokenView>& out) {
+    pending.clear();
+    pendingPos = 0;
+    lineNum = line;
+    failure = BSONError();
+    bool ok = tokenizeValue(value, line) && (!pending.empty() || fail(BSON_ERR_TYPE));
+    out.assign(pending.begin(), pending.end());
+    pending.clear();
+    return ok;
+}
+
+// arrayElementEnd
+// Finds the comma ending the array element that starts at start, or the
+// end of inner. Commas in quoted strings and nested arrays do not separate
+// elements. Strings have no escapes, so a quote only ends a string when
+// blanks and then a comma or the end of the array follow it (or "|>", in a
+// nested array); any other quote is part of the text, as it is outside
+// arrays. An opening quote followed by a comma is a lone '"' element.
+size_t Lexer::arrayElementEnd(std::string_view inner, size_t start) {
+    const char* p = inner.data() + start;
+    const char* end = inner.data() + inner.size();
+    while (p != end && (*p == ' ' || *p == '\t')) p++;
+    if (p == end) return inner.size();
+
+    if (*p == '"') {
+        // The element ends after the first quote with only blanks between
+        // it and a comma (or the end)
+        for (const char* quote = p; quote;) {
+            const char* next = quote + 1;
+            while (next != end && (*next == ' ' || *next == '\t')) next++;
+            if (next == end || *next == ',') return static_cast<size_t>(next - inner.data());
+            quote = static_cast<const char*>(std::memchr(quote + 1, '"', static_cast<size_t>(end - quote - 1)));
+        }
+        return inner.size();
+    }
+    if (*p != '<') {
+        // Neither a string nor an array: no valid value of that kind holds
+        // a comma, so if the element went past this one it fails anyway
+        const void* comma = std::memchr(p, ',', static_cast<size_t>(end - p));
+        return comma ? static_cast<size_t>(static_cast<const char*>(comma) - inner.data()) : inner.size();
     }
 
-    throw std::runtime_error("It hurt itself in its confusion!");
+    // A nested array: track nesting and the strings inside it
+    bool quoted = false;
+    int depth = 0;
+    for (; p != end; p++) {
+        if (*p == '"') {
+            const char* next = p + 1;
+            while (next != end && (*next == ' ' || *next == '\t')) next++;
+            bool ends = next == end || *next == ',' || (depth > 0 && quoted && *next == '|' && next + 1 != end && next[1] == '>');
+            quoted = !ends;
+        } else if (quoted) {
+            // Only a quote can change anything inside a string
+            const void* quote = std::memchr(p, '"', static_cast<size_t>(end - p));
+            if (!quote) break;
+            p = static_cast<const char*>(quote) - 1;
+        } else if (*p == ',' && depth == 0) {
+            return static_cast<size_t>(p - inner.data());
+        } else if (*p == '<' && p + 1 != end && p[1] == '|') {
+            depth++;
+            p++;
+        } else if (*p == '|' && p + 1 != end && p[1] == '>') {
+            if (depth > 0) depth--;
+            p++;
+        }
+    }
+    return inner.size();
+}
+
+// countCommas
+// Eight bytes at a time: a byte of x is zero exactly where the text has a
+// comma, the usual carry-free test leaves a 1 in each of those bytes, and
+// the multiplication adds them up in the top byte.
+static size_t countCommas(std::string_view s) {
+    const uint64_t ones = 0x0101010101010101ull, low = 0x7f7f7f7f7f7f7f7full;
+    size_t count = 0, i = 0;
+    for (; i + 8 <= s.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, s.data() + i, 8);
+        uint64_t x = word ^ (ones * ',');
+        uint64_t commas = ~(((x & low) + low) | x | low) >> 7;
+        count += static_cast<size_t>((commas * ones) >> 56);
+    }
+    for (; i < s.size(); i++) count += s[i] == ',';
+    return count;
 }
 
 // tokenizeValue
 // Parses the value part of a key-value pair.
-void Lexer::tokenizeValue(const std::string& valStr, int lineNum) {
-    std::string s = trim(valStr);
-    if (s.empty()) return;
+bool Lexer::tokenizeValue(std::string_view valStr, int lineNum, int depth) {
+    std::string_view s = trim(valStr);
+    if (s.empty()) return true;
 
     // String Literal
     if (startsWith(s, "\"") && endsWith(s, "\"")) {
-        tokens.push_back({TOKEN_STRING, s.substr(1, s.length() - 2), lineNum, 0});
-        return;
+        pending.push_back({TOKEN_STRING, s.substr(1, s.length() - 2), lineNum, 0});
+        return true;
     }
     // Boolean: SuperEffective (True)
     if (s == "SuperEffective") {
-        tokens.push_back({TOKEN_BOOL, "true", lineNum, 0});
-        return;
+        pending.push_back({TOKEN_BOOL, "true", lineNum, 0});
+        return true;
     }
     // Boolean: NotVeryEffective (False)
     if (s == "NotVeryEffective") {
-        tokens.push_back({TOKEN_BOOL, "false", lineNum, 0});
-        return;
+        pending.push_back({TOKEN_BOOL, "false", lineNum, 0});
+        return true;
     }
     // Null: MissingNo
     if (s == "MissingNo") {
-        tokens.push_back({TOKEN_NULL, "", lineNum, 0});
-        return;
+        pending.push_back({TOKEN_NULL, "", lineNum, 0});
+        return true;
     }
     // Array: <| ... |>
     if (startsWith(s, "<|") && endsWith(s, "|>")) {
-        tokens.push_back({TOKEN_ARRAY_START, "", lineNum, 0});
-        std::string inner = s.substr(2, s.length() - 4);
-        std::stringstream ss(inner);
-        std::string segment;
+        if (depth == kMaxArrayDepth) return fail(BSON_ERR_TYPE);
+        std::string_view inner = s.substr(2, s.length() - 4);
+        // Reserve an element and a comma per comma, for the outermost array
+        // only: its count covers the nested ones, and reserving small
+        // amounts for each of those would defeat the vector's doubling.
+        // No token but the brackets is shorter than a byte, so the count is
+        // skipped once the capacity fits the length of the array, which it
+        // grows towards by doubling.
+        size_t bound = pending.size() + inner.size() + 3;
+        if (depth == 0 && pending.capacity() < bound) {
+            size_t needed = pending.size() + 2 * countCommas(inner) + 3;
+            pending.reserve(std::max(needed, std::min(2 * pending.capacity(), bound)));
+        }
+
+        pending.push_back({TOKEN_ARRAY_START, "", lineNum, 0});
+        size_t start = 0;
         bool first = true;
-        while(std::getline(ss, segment, ',')) {
-            if (!first) tokens.push_back({TOKEN_COMMA, "", lineNum, 0});
-            tokenizeValue(segment, lineNum); // Recursive call for array elements
+        while (start < inner.size()) {
+            size_t segEnd = arrayElementEnd(inner, start);
+            if (!first) pending.push_back({TOKEN_COMMA, "", lineNum, 0});
+            // Recursive call for array elements
+            if (!tokenizeValue(inner.substr(start, segEnd - start), lineNum, depth + 1)) return false;
             first = false;
+            start = segEnd + 1;
         }
-        tokens.push_back({TOKEN_ARRAY_END, "", lineNum, 0});
-        return;
+        pending.push_back({TOKEN_ARRAY_END, "", lineNum, 0});
+        return true;
     }
 
     // Number (Int/Float)
-    try {
-        size_t pos;
-        std::stoi(s, &pos);
-        if (pos == s.length()) {
-            tokens.push_back({TOKEN_NUMBER, s, lineNum, 0});
-            return;
-        }
-    } catch (...) {}
-
-    try {
-        size_t pos;
-        std::stod(s, &pos);
-        if (pos == s.length()) {
-            tokens.push_back({TOKEN_NUMBER, s, lineNum, 0});
-            return;
-        }
-    } catch (...) {}
+    TokenView number{TOKEN_NUMBER, s, lineNum, 0};
+    if (parseNumber(s, number)) {
+        pending.push_back(number);
+        return true;
+    }
+
+    return fail(BSON_ERR_TYPE);
+}
+
+// parseNumber
+// Classifies and converts a numeric literal in a single pass with
+// std::from_chars, storing the result in the token. Accepts exactly what
+// std::stoi followed by std::stod used to: leading whitespace, an optional
+// '+', hexadecimal floats, inf and nan; out-of-range and subnormal decimal
+// values are rejected.
+bool Lexer::parseNumber(std::string_view s, TokenView& token) {
+    const char* first = s.data();
+    const char* last = first + s.size();
+    while (first != last && std::isspace(static_cast<unsigned char>(*first))) first++;
+    // from_chars has no '+'; a second sign after it was never valid
+    if (first != last && *first == '+') {
+        first++;
+        if (first != last && (*first == '+' || *first == '-')) return false;
+    }
+
+    int intValue;
+    auto result = std::from_chars(first, last, intValue);
+    if (result.ec == std::errc() && result.ptr == last) {
+        token.isFloat = false;
+        token.intValue = intValue;
+        return true;
+    }
 
-    throw std::runtime_error("Target is immune!");
+    // Hexadecimal floats: from_chars wants them without the sign and "0x".
+    // It would also take inf or nan there, so a hex digit must follow, as
+    // strtod wants; otherwise the decimal read stops at the 0 and fails.
+    const char* p = first;
+    bool negative = p != last && *p == '-';
+    if (negative) p++;
+    if (last - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') &&
+        (std::isxdigit(static_cast<unsigned char>(p[2])) ||
+         (p[2] == '.' && last - p > 3 && std::isxdigit(static_cast<unsigned char>(p[3]))))) {
+        double hexValue;
+        result = std::from_chars(p + 2, last, hexValue, std::chars_format::hex);
+        if (result.ec != std::errc() || result.ptr != last) return false;
+        token.isFloat = true;
+        token.floatValue = negative ? -hexValue : hexValue;
+        return true;
+    }
+
+    double floatValue;
+    result = std::from_chars(first, last, floatValue);
+    if (result.ec != std::errc() || result.ptr != last) return false;
+    // std::stod reported inexact underflow as out of range
+    if (std::fpclassify(floatValue) == FP_SUBNORMAL) return false;
+    token.isFloat = true;
+    token.floatValue = floatValue;
+    return true;
+}
+
+// scanKeyValue
+// Hand-written equivalent of the pattern ^([a-zA-Z0-9_]+)\s*(~{1,}>)\s*(.*)$
+// Walks the line once and reports where the key ends and the value starts.
+bool Lexer::scanKeyValue(std::string_view line, size_t& keyEnd, size_t& valueStart) {
+    auto isSpace = [](char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    };
+    auto isKeyChar = [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    };
+    size_t i = 0, n = line.size();
+
+    // Key: [a-zA-Z0-9_]+
+    while (i < n && isKeyChar(line[i])) i++;
+    if (i == 0) return false;
+    keyEnd = i;
+
+    // Vine Whip: ~{1,}>
+    while (i < n && isSpace(line[i])) i++;
+    size_t whipStart = i;
+    while (i < n && line[i] == '~') i++;
+    if (i == whipStart || i == n || line[i] != '>') return false;
+    i++;
+
+    // Value: anything up to the end of the line, except line terminators
+    while (i < n && isSpace(line[i])) i++;
+    valueStart = i;
+    for (; i < n; i++) {
+        if (line[i] == '\n' || line[i] == '\r') return false;
+    }
+    return true;
 }
 
-std::string Lexer::trim(const std::string& str) {
-    size_t first = str.find_first_not_of(" \t");
-    if (std::string::npos == first) return "";
-    size_t last = str.find_last_not_of(" \t");
-    return str.substr(first, (last - first + 1));
+std::string_view Lexer::trim(std::string_view str) {
+    // Runs once per array element: plain loops beat find_first_not_of
+    size_t first = 0, last = str.size();
+    while (first < last && (str[first] == ' ' || str[first] == '\t')) first++;
+    if (first == last) return {};
+    while (str[last - 1] == ' ' || str[last - 1] == '\t') last--;
+    return str.substr(first, last - first);
 }
 
-bool Lexer::startsWith(const std::string& str, const std::string& prefix) {
+bool Lexer::startsWith(std::string_view str, std::string_view prefix) {
     return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
 }
 
-bool Lexer::endsWith(const std::string& str, const std::string& suffix) {
+bool Lexer::endsWith(std::string_view str, std::string_view suffix) {
     return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
@@ -1,6 +1,12 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include "StructuralIndex.hpp"
+#include "BSONError.hpp"
+#include "BSONKeyInterner.hpp"
+
+struct BSONStats;
 
 // TokenType Enum
 // Defines all possible tokens in the BSON language.
@@ -19,7 +25,9 @@ enum TokenType {
     TOKEN_ARRAY_START,    // <|
     TOKEN_ARRAY_END,      // |>
     TOKEN_COMMA,          // ,
-    TOKEN_EOF             // End of File
+    TOKEN_RAW_VALUE,      // Undecoded value text (see Lexer::setLazyValues)
+    TOKEN_EOF,            // End of File
+    TOKEN_ERROR           // Lexical error; see Lexer::error()
 };
 
 // Token Structure
@@ -29,6 +37,23 @@ struct Token {
     std::string literal; // The actual text content
     int line;            // Line number for error reporting
     int level;           // For INDENT and SECTION tokens, stores the nesting level
+    // For NUMBER tokens, the value converted by the lexer
+    bool isFloat = false;
+    int intValue = 0;
+    double floatValue = 0.0;
+};
+
+// TokenView Structure
+// Same as Token, but the literal is a view into the lexer's source buffer
+// (or a static string), so producing it never allocates.
+struct TokenView {
+    TokenType type;
+    std::string_view literal; // Valid for as long as the source buffer is
+    int line;
+    int level;
+    bool isFloat = false;
+    int intValue = 0;
+    double floatValue = 0.0;
 };
 
 // Lexer Class
@@ -36,19 +61,94 @@ struct Token {
 // Encapsulates the lexical analysis logic, hiding the complexity of string parsing.
 class Lexer {
 public:
+    // Arrays nest at most this deep; a deeper one is a type error. Each
+    // level rescans the text of the arrays inside it, so the limit also
+    // keeps lexing linear in the length of the line.
+    static constexpr int kMaxArrayDepth = 64;
+
+    // Empty lexer, to be pointed at input with reset()
+    Lexer() : Lexer(std::string_view()) {}
+    // Owning constructor: the lexer keeps its own copy of the content.
     Lexer(const std::string& content);
-    
+    // Zero-copy constructor: the caller keeps the buffer alive while the
+    // lexer and any TokenView it produced are in use.
+    Lexer(std::string_view content);
+    Lexer(const char* content);
+
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
+
+    // Starts over on a new buffer (zero-copy, like the string_view
+    // constructor). The token buffers keep their capacity, so a lexer that
+    // is reset between inputs stops allocating once it has seen the longest
+    // line. The interner and lazy mode stay as they were set.
+    void reset(std::string_view newSource);
+    // Moves on to a buffer holding the lines that follow the current one's:
+    // line numbers and the header check carry over, as if both buffers were
+    // one. Call once next() has returned TOKEN_EOF.
+    void resume(std::string_view more);
+
     // Main method to generate tokens
+    // Throws std::runtime_error with the spec's message on invalid input.
     std::vector<Token> tokenize();
+    // Zero-copy variant: token literals point into the source buffer.
+    // The vector is reused: it holds the tokens of the latest call only.
+    const std::vector<TokenView>& tokenizeView();
+    // Streaming variant: returns the next token, lexing lines on demand.
+    // Returns TOKEN_EOF once the input is exhausted. Never throws: invalid
+    // input yields TOKEN_ERROR (from then on) and error() says why.
+    TokenView next();
+    const BSONError& error() const { return failure; }
+    // Number of the line lexed last (the one whose tokens are being handed out)
+    int line() const { return lineNum; }
+
+    // Lexes the source as the continuation of a document whose header has
+    // already been read: no header is expected and line numbers count from
+    // the start of the source. Call before the first next().
+    void skipHeader() { firstLine = false; }
+
+    // With an interner, identifier literals are views of its interned keys
+    // (so they outlive the source buffer) instead of views into the source.
+    void setKeyInterner(BSONKeyInterner* keys) { interner = keys; }
+
+    // In lazy mode the text after each vine whip is not lexed: it comes out
+    // as one TOKEN_RAW_VALUE, to be decoded later with lexValue(). Invalid
+    // values then go unnoticed until they are decoded.
+    void setLazyValues(bool lazy) { lazyValues = lazy; }
+    // Adds the bytes, lines, tokens and lexing time of every later input to
+    // stats, in BSON_STATS builds (see BSONStats.hpp); nullptr stops it.
+    void setStats(BSONStats* counters) { stats = counters; }
+    // Lexes a single value (the text after a vine whip) into out.
+    // Returns false and sets error() if the value is invalid.
+    bool lexValue(std::string_view value, int line, std::vector<TokenView>& out);
 
 private:
-    std::string content;
-    std::vector<Token> tokens;
-    
+    std::string content;     // Only used by the owning constructor
+    std::string_view source; // The buffer being tokenized
+    StructuralIndex index;   // Newline / comment / indentation bitmaps over source
+    std::vector<TokenView> tokens;
+
+    // Streaming state
+    size_t pos = 0;                 // Start of the next unread line
+    int lineNum = 0;
+    bool firstLine = true;
+    std::vector<TokenView> pending; // Tokens of the current line
+    size_t pendingPos = 0;
+    BSONError failure;
+    BSONKeyInterner* interner = nullptr;
+    bool lazyValues = false;
+    BSONStats* stats = nullptr;
+
     // Helper methods for internal logic
-    void tokenizeLine(const std::string& line, int lineNum);
-    void tokenizeValue(const std::string& valStr, int lineNum);
-    std::string trim(const std::string& str);
-    bool startsWith(const std::string& str, const std::string& prefix);
-    bool endsWith(const std::string& str, const std::string& suffix);
+    bool lexNextLine();
+    bool fail(BSONErrorCode code);
+    bool tokenizeLine(std::string_view line, int lineNum);
+    std::string_view identifier(std::string_view key);
+    bool tokenizeValue(std::string_view valStr, int lineNum, int depth = 0);
+    bool parseNumber(std::string_view s, TokenView& token);
+    size_t arrayElementEnd(std::string_view inner, size_t start);
+    bool scanKeyValue(std::string_view line, size_t& keyEnd, size_t& valueStart);
+    std::string_view trim(std::string_view str);
+    bool startsWith(std::string_view str, std::string_view prefix);
+    bool endsWith(std::string_view str, std::string_view suffix);
 };
@@ -0,0 +1,115 @@
+#include "MappedFile.hpp"
+#include "BSONParser.hpp"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open file: " + path);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot read file: " + path);
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+
+    // An empty file cannot be mapped; it is simply an empty view
+    if (length > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    CloseHandle(file);
+    if (length > 0 && !data) {
+        if (mapping) CloseHandle(mapping);
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+}
+
+void MappedFile::unmap() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    data = nullptr;
+    mapping = nullptr;
+    length = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open file: " + path);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read file: " + path);
+    }
+    length = static_cast<size_t>(info.st_size);
+
+    // An empty file cannot be mapped; it is simply an empty view
+    if (length > 0) {
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        // The lexer reads front to back exactly once
+        madvise(p, length, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(p);
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+void MappedFile::unmap() {
+    if (data) munmap(const_cast<char*>(data), length);
+    data = nullptr;
+    length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() { unmap(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr)), length(std::exchange(other.length, 0)) {
+#ifdef _WIN32
+    mapping = std::exchange(other.mapping, nullptr);
+#endif
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+#ifdef _WIN32
+        mapping = std::exchange(other.mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+// parseFile
+// Lexes straight from the mapped pages; the mapping only has to outlive the
+// parse, since the tree owns copies of every key and string.
+BSONMap BSONParser::parseFile(const std::string& path) {
+    MappedFile file(path);
+    BSONTreeBuilder builder;
+    parse(file.view(), builder);
+    return builder.take();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// MappedFile Class
+// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping
+// on Windows). view() exposes the mapped pages directly, so the lexer can
+// read the file without it ever being copied into a std::string.
+// Throws std::runtime_error if the file cannot be opened or mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // The file contents; valid for as long as the mapping is alive
+    std::string_view view() const { return {data, length}; }
+    size_t size() const { return length; }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* mapping = nullptr; // HANDLE of the file mapping object
+#endif
+
+    void unmap();
+};
@@ -0,0 +1,157 @@
+#include "StructuralIndex.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static inline unsigned countTrailingZeros(uint64_t m) {
+    unsigned long index;
+    _BitScanForward64(&index, m);
+    return static_cast<unsigned>(index);
+}
+#else
+static inline unsigned countTrailingZeros(uint64_t m) { return static_cast<unsigned>(__builtin_ctzll(m)); }
+#endif
+
+// classify
+// Compares the 64 bytes at p against every structural character at once.
+// z and bigZ receive the raw 'z' / 'Z' bitmaps for comment detection.
+void StructuralIndex::classify(const char* p, Block& out, uint64_t& z, uint64_t& bigZ) {
+#if defined(__AVX2__)
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    auto match = [&](char c) {
+        const __m256i needle = _mm256_set1_epi8(c);
+        uint64_t a = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+        uint64_t b = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+        return a | (b << 32);
+    };
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128i chunk[4];
+    for (int i = 0; i < 4; i++) chunk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+    auto match = [&](char c) {
+        const __m128i needle = _mm_set1_epi8(c);
+        uint64_t m = 0;
+        for (int i = 0; i < 4; i++) {
+            m |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[i], needle)))) << (16 * i);
+        }
+        return m;
+    };
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t chunk[4];
+    for (int i = 0; i < 4; i++) chunk[i] = vld1q_u8(reinterpret_cast<const uint8_t*>(p + 16 * i));
+    // NEON has no movemask: weight each lane by its bit and fold with pairwise adds
+    const uint8x16_t weights = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    auto match = [&](char c) {
+        const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+        uint8x16_t m0 = vandq_u8(vceqq_u8(chunk[0], needle), weights);
+        uint8x16_t m1 = vandq_u8(vceqq_u8(chunk[1], needle), weights);
+        uint8x16_t m2 = vandq_u8(vceqq_u8(chunk[2], needle), weights);
+        uint8x16_t m3 = vandq_u8(vceqq_u8(chunk[3], needle), weights);
+        uint8x16_t sum = vpaddq_u8(vpaddq_u8(m0, m1), vpaddq_u8(m2, m3));
+        sum = vpaddq_u8(sum, sum);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+    };
+#else
+    auto match = [&](char c) {
+        uint64_t m = 0;
+        for (int i = 0; i < 64; i++) {
+            if (p[i] == c) m |= uint64_t(1) << i;
+        }
+        return m;
+    };
+#endif
+    out.newline = match('\n');
+    out.space = match(' ');
+    out.comment = 0;
+    z = match('z');
+    bigZ = match('Z');
+}
+
+void StructuralIndex::reset(std::string_view newSource) {
+    source = newSource;
+    windowStart = 0;
+    windowBlocks = 0;
+}
+
+// classifyAt
+// Classifies the block at offset, zero-padding it past the end of the source.
+void StructuralIndex::classifyAt(size_t offset, Block& out, uint64_t& z, uint64_t& bigZ) const {
+    if (offset + 64 <= source.size()) {
+        classify(source.data() + offset, out, z, bigZ);
+        return;
+    }
+    char tail[64] = {};
+    if (offset < source.size()) std::memcpy(tail, source.data() + offset, source.size() - offset);
+    classify(tail, out, z, bigZ);
+}
+
+// buildWindow
+// Classifies the blocks of a new window. A "zZz" may straddle two blocks,
+// so the z/Z bitmaps of each following block are folded into the comment
+// bitmap of the block before it.
+void StructuralIndex::buildWindow(size_t start) {
+    windowStart = start;
+    size_t remaining = source.size() > start ? source.size() - start : 0;
+    windowBlocks = std::min(kWindowBlocks, (remaining + 63) / 64);
+    if (windowBlocks == 0) windowBlocks = 1;
+
+    uint64_t z, bigZ;
+    classifyAt(start, blocks[0], z, bigZ);
+    for (size_t b = 0; b < windowBlocks; b++) {
+        uint64_t nextZ = 0, nextBigZ = 0;
+        Block next;
+        size_t nextOffset = start + (b + 1) * 64;
+        if (nextOffset < source.size()) {
+            classifyAt(nextOffset, next, nextZ, nextBigZ);
+            if (b + 1 < windowBlocks) blocks[b + 1] = next;
+        }
+        blocks[b].comment = z & ((bigZ >> 1) | (nextBigZ << 63)) & ((z >> 2) | (nextZ << 62));
+        z = nextZ;
+        bigZ = nextBigZ;
+    }
+}
+
+size_t StructuralIndex::blockFor(size_t pos) {
+    if (windowBlocks == 0 || pos < windowStart || pos >= windowStart + windowBlocks * 64) {
+        buildWindow(pos & ~static_cast<size_t>(63));
+    }
+    return (pos - windowStart) / 64;
+}
+
+template <uint64_t StructuralIndex::Block::*Field>
+size_t StructuralIndex::findBit(size_t pos, size_t end, bool invert) {
+    while (pos < end) {
+        size_t b = blockFor(pos);
+        size_t blockStart = windowStart + b * 64;
+        uint64_t m = blocks[b].*Field;
+        if (invert) m = ~m;
+        m &= ~uint64_t(0) << (pos - blockStart);
+        if (m != 0) {
+            size_t found = blockStart + countTrailingZeros(m);
+            return found < end ? found : npos;
+        }
+        pos = blockStart + 64;
+    }
+    return npos;
+}
+
+size_t StructuralIndex::nextNewline(size_t pos) {
+    size_t found = findBit<&Block::newline>(pos, source.size(), false);
+    return found == npos ? source.size() : found;
+}
+
+size_t StructuralIndex::findComment(size_t pos, size_t end) {
+    return findBit<&Block::comment>(pos, end, false);
+}
+
+size_t StructuralIndex::countSpaces(size_t pos, size_t end) {
+    size_t found = findBit<&Block::space>(pos, end, true);
+    return (found == npos ? end : found) - pos;
+}
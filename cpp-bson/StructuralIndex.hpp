@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// StructuralIndex Class
+// Vectorized pre-pass over the lexer's source buffer. The input is classified
+// 64 bytes at a time into bitmaps (bit i = byte i of the block) marking
+// newlines, spaces and the first byte of each "zZz" comment marker. The
+// lexer asks the index for the next newline, the first comment on a line
+// and the width of the indentation instead of looping over bytes.
+//
+// The bitmaps are computed for a sliding window of blocks, so memory stays
+// constant no matter how large the source is. The classifier uses AVX2 or
+// SSE2 on x86, NEON on ARM, and a scalar loop everywhere else.
+class StructuralIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    StructuralIndex() = default;
+    explicit StructuralIndex(std::string_view source) : source(source) {}
+
+    void reset(std::string_view newSource);
+
+    // Position of the first '\n' at or after pos, or source.size()
+    size_t nextNewline(size_t pos);
+    // Position of the first "zZz" starting in [pos, end), or npos
+    size_t findComment(size_t pos, size_t end);
+    // Number of consecutive spaces starting at pos, stopping at end
+    size_t countSpaces(size_t pos, size_t end);
+
+    // Bitmaps of one 64-byte block
+    struct Block {
+        uint64_t newline;
+        uint64_t space;
+        uint64_t comment;
+    };
+
+    // Classifies 64 bytes at p (the comment bitmap is left to the caller,
+    // since it depends on the following block)
+    static void classify(const char* p, Block& out, uint64_t& z, uint64_t& bigZ);
+
+private:
+    static constexpr size_t kWindowBlocks = 64; // 4 KiB of input per window
+
+    std::string_view source;
+    size_t windowStart = 0; // Byte offset of the first block in the window
+    size_t windowBlocks = 0;
+    Block blocks[kWindowBlocks];
+
+    // Makes sure the block holding pos is in the window; returns its index
+    size_t blockFor(size_t pos);
+    void buildWindow(size_t start);
+    void classifyAt(size_t offset, Block& out, uint64_t& z, uint64_t& bigZ) const;
+
+    // Scans the bitmap chosen by field for the first set bit in [pos, end)
+    template <uint64_t Block::*Field>
+    size_t findBit(size_t pos, size_t end, bool invert);
+};
@@ -0,0 +1,84 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    shares.reset(new Share[threads]);
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& fn) {
+    parallelFor(n, [&](size_t i, unsigned) { fn(i); });
+}
+
+// parallelFor
+// Splits the indices into one share per thread, posts the loop to the
+// workers, runs iterations on the calling thread until none are left, then
+// waits for the workers to finish theirs.
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t, unsigned)>& fn) {
+    if (n == 0) return;
+    if (workers.empty() || n == 1) {
+        for (size_t i = 0; i < n; i++) fn(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        size_t threads = size();
+        for (size_t t = 0; t < threads; t++) {
+            shares[t].next.store(n * t / threads, std::memory_order_relaxed);
+            shares[t].end = n * (t + 1) / threads;
+        }
+        busy = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busy == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+
+        lock.unlock();
+        drain(self);
+        lock.lock();
+
+        if (--busy == 0) done.notify_one();
+    }
+}
+
+// drain
+// Runs the thread's own share, then steals from the other shares in turn
+// until every index of the current loop has been claimed. Owner and thieves
+// claim the same way, from the front of a share, so each index runs once.
+void ThreadPool::drain(unsigned self) {
+    unsigned threads = size();
+    for (unsigned k = 0; k < threads; k++) {
+        Share& share = shares[(self + k) % threads];
+        for (size_t i = share.next.fetch_add(1); i < share.end; i = share.next.fetch_add(1)) {
+            (*task)(i, self);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool Class
+// A fixed set of worker threads that run the iterations of a parallelFor.
+// Every thread starts on its own contiguous share of the indices and claims
+// them one at a time; a thread whose share runs out steals indices from the
+// others, so uneven iterations (e.g. chunks of different sizes) still
+// balance without all threads contending on one counter.
+// The calling thread takes part in the loop as well.
+class ThreadPool {
+public:
+    // threads counts the caller too; 0 means one per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that run a parallelFor, including the caller
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Calls fn(i) for every i in [0, n) and returns once all calls are done.
+    // One parallelFor runs at a time; fn must not throw.
+    void parallelFor(size_t n, const std::function<void(size_t)>& fn);
+    // Same, also passing the index of the thread running the call, in
+    // [0, size()): state kept per thread index is never used concurrently.
+    void parallelFor(size_t n, const std::function<void(size_t, unsigned)>& fn);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake; // A new loop was posted, or the pool is stopping
+    std::condition_variable done; // The last busy worker finished
+
+    // Indices [next, end) of one thread's share that are still unclaimed;
+    // padded to a cache line so owners do not contend with each other
+    struct alignas(64) Share {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+
+    // The loop being run
+    const std::function<void(size_t, unsigned)>* task = nullptr;
+    std::unique_ptr<Share[]> shares; // One per thread, the caller's first
+    size_t generation = 0; // Bumped for every parallelFor
+    size_t busy = 0;       // Workers still inside the current loop
+    bool stopping = false;
+
+    void workerLoop(unsigned self);
+    void drain(unsigned self);
+};
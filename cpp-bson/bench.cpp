@@ -0,0 +1,198 @@
+// Benchmark harness for the C++ BSON parser.
+//
+// Generates synthetic documents and reports, for each one, the throughput of
+// every parse phase in MB/s together with the number of heap allocations
+// performed per document:
+//
+//   lex    pulling tokens from the Lexer only
+//   parse  the event-driven parser with a handler that does nothing
+//   tree   BSONParser::parse into a BSONMap
+//   arena  BSONParser::parseArena
+//   tape   BSONParser::parseTape
+//   lazy   BSONParser::parseLazy (skeleton only, no value decoded)
+//   par    BSONParser::parseParallel on one thread per core
+//
+// Usage: ./bench [scale]   (scale multiplies the default document sizes)
+
+#include "BSONParser.hpp"
+#include "BSONArena.hpp"
+#include "BSONTape.hpp"
+#include "BSONLazy.hpp"
+#include "Lexer.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+// Allocation Counting
+// Every global operator new goes through here; the array, nothrow and sized
+// forms fall back to these by default.
+static std::atomic<size_t> allocationCount{0};
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// Document Generators
+
+static const char* const kValues[] = {
+    "\"Bulbasaur\"", "42", "-7", "3.14159", "1.5e10", "SuperEffective",
+    "NotVeryEffective", "MissingNo", "<| 1, 2, 3 |>", "\"vine, whip\"",
+};
+
+// Millions of keys in a single flat section
+static std::string flatDocument(size_t keys) {
+    std::string doc = "BULBA!\n";
+    for (size_t i = 0; i < keys; i++) {
+        doc += "key" + std::to_string(i) + " ~> " + kValues[i % 10] + "\n";
+    }
+    return doc;
+}
+
+// A few keys, each holding a long array
+static std::string wideArrayDocument(size_t keys, size_t width) {
+    std::string doc = "BULBA!\n";
+    for (size_t i = 0; i < keys; i++) {
+        doc += "list" + std::to_string(i) + " ~> <| ";
+        for (size_t j = 0; j < width; j++) {
+            if (j) doc += ", ";
+            doc += (j % 3 == 0) ? "\"item\"" : (j % 3 == 1) ? std::to_string(j) : "2.5";
+        }
+        doc += " |>\n";
+    }
+    return doc;
+}
+
+// Sections nested to the maximum depth, with the payload at (@) level
+static std::string deepDocument(size_t sections) {
+    std::string doc = "BULBA!\n";
+    for (size_t i = 0; i < sections; i++) {
+        std::string n = std::to_string(i);
+        doc += "(o) region" + n + " (o)\n";
+        doc += "    (O) route" + n + " (O)\n";
+        for (int j = 0; j < 4; j++) {
+            doc += "        (@) grass" + std::to_string(j) + " (@)\n";
+            for (int k = 0; k < 8; k++) {
+                doc += "            key" + std::to_string(k) + " ~> " + kValues[(i + k) % 10] + "\n";
+            }
+        }
+    }
+    return doc;
+}
+
+// Every other line is a comment, and values carry trailing comments
+static std::string commentDocument(size_t keys) {
+    std::string doc = "BULBA!\n";
+    for (size_t i = 0; i < keys; i++) {
+        doc += "zZz Bulbasaur is sleeping, this line is ignored by the lexer\n";
+        doc += "key" + std::to_string(i) + " ~> " + kValues[i % 10] + " zZz trailing note\n";
+    }
+    return doc;
+}
+
+// Measurement
+
+// A handler that accepts every event, so only the lexer and grammar are timed
+class NullHandler : public BSONHandler {};
+
+struct Measurement {
+    double seconds;
+    size_t allocations;
+};
+
+// Runs fn until at least minSeconds have passed (and at least three times),
+// keeping the fastest run and its allocation count.
+static Measurement measure(const std::function<void()>& fn, double minSeconds = 0.5) {
+    Measurement best{1e300, 0};
+    double total = 0;
+    for (int run = 0; run < 3 || total < minSeconds; run++) {
+        size_t before = allocationCount.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        size_t allocations = allocationCount.load(std::memory_order_relaxed) - before;
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        total += seconds;
+        if (seconds < best.seconds) best = {seconds, allocations};
+    }
+    return best;
+}
+
+static void report(const char* phase, size_t bytes, const Measurement& m) {
+    std::printf("  %-6s %10.1f MB/s %12zu allocs/doc\n", phase, bytes / m.seconds / 1e6, m.allocations);
+}
+
+static void benchmark(const char* name, const std::string& doc) {
+    std::printf("%s (%.1f MB)\n", name, doc.size() / 1e6);
+
+    size_t tokens = 0;
+    report("lex", doc.size(), measure([&] {
+        Lexer lexer{std::string_view(doc)};
+        tokens = 0;
+        for (TokenView t = lexer.next(); t.type != TOKEN_EOF && t.type != TOKEN_ERROR; t = lexer.next()) tokens++;
+    }));
+    report("parse", doc.size(), measure([&] {
+        BSONParser parser;
+        NullHandler handler;
+        parser.parse(std::string_view(doc), handler);
+    }));
+    report("tree", doc.size(), measure([&] {
+        BSONParser parser;
+        BSONMap map = parser.parse(doc);
+    }));
+    report("arena", doc.size(), measure([&] {
+        BSONParser parser;
+        ArenaDocument arena = parser.parseArena(doc);
+    }));
+    {
+        // One parser, document and builder kept across parses; two warm-up
+        // parses grow the buffers, so the row shows the steady state
+        BSONParser parser;
+        ArenaDocument arena;
+        ArenaBuilder builder(arena);
+        auto parseAgain = [&] {
+            arena.reset();
+            builder.reset();
+            parser.parse(std::string_view(doc), builder);
+            builder.finish();
+        };
+        parseAgain();
+        parseAgain();
+        report("reuse", doc.size(), measure(parseAgain));
+    }
+    report("tape", doc.size(), measure([&] {
+        BSONParser parser;
+        BSONTape tape = parser.parseTape(doc);
+    }));
+    report("lazy", doc.size(), measure([&] {
+        BSONParser parser;
+        LazyDocument lazy = parser.parseLazy(doc);
+    }));
+    static ThreadPool pool;
+    report("par", doc.size(), measure([&] {
+        BSONParser parser;
+        BSONMap map = parser.parseParallel(doc, pool);
+    }));
+    std::printf("  %zu tokens, %u threads\n", tokens, pool.size());
+}
+
+int main(int argc, char** argv) {
+    size_t scale = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1;
+    if (scale == 0) scale = 1;
+
+    benchmark("flat: one key per line", flatDocument(1000000 * scale));
+    benchmark("wide arrays: 1000 elements each", wideArrayDocument(1000 * scale, 1000));
+    benchmark("deep: (o)/(O)/(@) sections", deepDocument(20000 * scale));
+    benchmark("comments: every other line", commentDocument(500000 * scale));
+    return 0;
+}
@@ -0,0 +1,244 @@
+// Corpus generator for fuzz_parse.cpp and fuzz_differential.sh.
+//
+//   ./fuzz_corpus <dir> [count] [seed]
+//
+// Writes count random documents (doc_00000.bson ...) and a fixed set of
+// large, pathological seeds (big_*.bson) to dir. The random documents keep
+// to what every implementation supports: evolution markers, scalars, flat
+// arrays, comments. About one in eight is broken on
+// purpose (tab, bad indentation, Charizard, missing vine whip, ...), so the
+// errors are compared too. A document has a single defect at most: the
+// implementations do not all check in the same order. The big seeds exercise input sizes rather than
+// features: long lines, wide arrays, deep nesting, long dedent chains. They
+// are meant for the fuzzer and the time and memory budgets, and are not
+// part of the differential run.
+//
+// The output only depends on the seed: the generator draws from mt19937's
+// raw output, which the standard fixes, not from its distributions.
+
+#include "Lexer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(uint32_t seed) : random(seed) {}
+
+    std::string document() {
+        out.clear();
+        defects = below(8) == 0 ? 1 : 0;
+        out += defect(8) ? "BULBA" : "BULBA!";
+        out += '\n';
+        section(0, 1 + below(8));
+        return out;
+    }
+
+private:
+    std::mt19937 random;
+    std::string out;
+    int defects = 0; // Still to put in the document
+
+    uint32_t below(uint32_t n) { return random() % n; }
+
+    // Whether to break the document here, a one in n chance if it is broken
+    bool defect(uint32_t n) {
+        if (defects == 0 || below(n) != 0) return false;
+        defects--;
+        return true;
+    }
+
+    void indent(int level) { out.append(static_cast<size_t>(level) * 4, ' '); }
+
+    // Lines for the members of a section at level
+    void section(int level, uint32_t members) {
+        for (uint32_t i = 0; i < members; i++) {
+            switch (below(10)) {
+                case 0:
+                    out += '\n';
+                    break;
+                case 1:
+                    indent(level);
+                    out += "zZz ";
+                    out += word();
+                    out += '\n';
+                    break;
+                case 2:
+                case 3:
+                    if (level < 3) {
+                        static const char* markers[] = {"(o)", "(O)", "(@)"};
+                        const char* marker = markers[level];
+                        // A marker one level too deep has not enough badges
+                        if (level < 2 && defect(16)) marker = markers[level + 1];
+                        indent(level);
+                        out += marker;
+                        out += ' ';
+                        out += key();
+                        out += ' ';
+                        out += marker;
+                        out += '\n';
+                        section(level + 1, 1 + below(5));
+                        break;
+                    }
+                    [[fallthrough]];
+                default:
+                    member(level);
+                    break;
+            }
+        }
+    }
+
+    void member(int level) {
+        if (defect(24)) {
+            out += '\t';
+            indent(level);
+        } else if (defect(24)) {
+            indent(level);
+            out += "   ";
+        } else {
+            indent(level);
+        }
+        out += defect(24) ? "Charizard" : key();
+        if (defect(24)) {
+            out += " 1\n";
+            return;
+        }
+        out += ' ';
+        out += std::string(1 + below(6), '~');
+        out += "> ";
+        if (defect(24)) {
+            out += "Unknown";
+        } else {
+            value(false);
+        }
+        if (below(8) == 0) out += " zZz trailing";
+        out += '\n';
+    }
+
+    std::string word() {
+        static const char* words[] = {"alpha", "Bulba", "pool", "max", "seed", "vine", "x1", "HP"};
+        return words[below(8)];
+    }
+
+    std::string key() {
+        static const char* keys[] = {"a", "b", "host", "port", "list", "_k", "key_2", "Value", "x", "timeout_ms"};
+        return keys[below(10)];
+    }
+
+    std::string number() {
+        switch (below(5)) {
+            case 0: return std::to_string(below(1000));
+            case 1: return "-" + std::to_string(1 + below(1000));
+            case 2: return std::to_string(below(100)) + "." + std::to_string(below(100));
+            case 3: return std::to_string(1 + below(9)) + "e" + std::to_string(below(20));
+            default: return std::to_string(random());
+        }
+    }
+
+    // Arrays are flat: nested ones are an extension of this implementation
+    void value(bool inArray) {
+        switch (below(inArray ? 7 : 9)) {
+            case 0: out += "\"" + word() + (below(2) ? " " + word() : "") + "\""; break;
+            case 1: out += "\"\""; break;
+            case 2:
+            case 3: out += number(); break;
+            case 4: out += below(2) ? "SuperEffective" : "NotVeryEffective"; break;
+            case 5: out += "MissingNo"; break;
+            case 6: out += "\"" + word() + "\""; break;
+            default: {
+                out += "<|";
+                uint32_t count = below(5);
+                for (uint32_t i = 0; i < count; i++) {
+                    out += i ? ", " : " ";
+                    value(true);
+                }
+                out += count ? " |>" : "|>";
+                break;
+            }
+        }
+    }
+};
+
+// Big seeds
+
+static std::string header() { return "BULBA!\n"; }
+
+static std::string repeat(const std::string& text, size_t times) {
+    std::string out;
+    out.reserve(text.size() * times);
+    for (size_t i = 0; i < times; i++) out += text;
+    return out;
+}
+
+static std::string nestedArrays(int levels) {
+    return repeat("<| ", levels) + "1" + repeat(" |>", levels);
+}
+
+struct Seed {
+    const char* name;
+    std::string content;
+};
+
+static std::vector<Seed> bigSeeds() {
+    const size_t n = 1 << 20;
+    return {
+        {"big_vine_whip", header() + "k " + std::string(n, '~') + "> 1\n"},
+        {"big_string", header() + "k ~> \"" + std::string(n, 'x') + "\"\n"},
+        {"big_key", header() + std::string(n, 'k') + " ~> 1\n"},
+        {"big_comment", header() + "zZz " + std::string(n, 'z') + "\nk ~> 1\n"},
+        {"big_array", header() + "k ~> <| " + repeat("1, ", n / 3) + "2 |>\n"},
+        {"big_string_array", header() + "k ~> <| " + repeat("\"a\", ", n / 5) + "\"b\" |>\n"},
+        {"big_nested_array", header() + "k ~> <| " + repeat("<|1|>, ", n / 7) + "<|2|> |>\n"},
+        {"big_deep_array", header() + repeat("k ~> " + nestedArrays(Lexer::kMaxArrayDepth) + "\n", n / 400)},
+        {"big_too_deep_array", header() + "k ~> " + nestedArrays(n / 6) + "\n"},
+        {"big_keys", header() + repeat("key ~> 12345\n", n / 13)},
+        {"big_blank_lines", header() + "a ~> 1\n" + std::string(n, '\n') + "b ~> 2\n"},
+        {"big_dedent_chain", header() + repeat("(o) a (o)\n    (O) b (O)\n        (@) c (@)\n            x ~> 1\nx ~> 2\n",
+                                               n / 64)},
+        {"big_spaces", header() + "k" + std::string(n, ' ') + "~> " + std::string(n, ' ') + "1\n"},
+    };
+}
+
+static bool writeFile(const std::filesystem::path& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    if (!file) {
+        std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <dir> [count] [seed]\n", argv[0]);
+        return 1;
+    }
+    std::filesystem::path dir = argv[1];
+    unsigned long count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500;
+    uint32_t seed = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 1;
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        std::fprintf(stderr, "Cannot create %s: %s\n", dir.c_str(), error.message().c_str());
+        return 1;
+    }
+
+    CorpusGenerator generator(seed);
+    for (unsigned long i = 0; i < count; i++) {
+        char name[32];
+        std::snprintf(name, sizeof name, "doc_%05lu.bson", i);
+        if (!writeFile(dir / name, generator.document())) return 1;
+    }
+    std::vector<Seed> seeds = bigSeeds();
+    for (const Seed& big : seeds) {
+        if (!writeFile(dir / (std::string(big.name) + ".bson"), big.content)) return 1;
+    }
+    std::printf("Wrote %lu documents and %zu big seeds to %s\n", count, seeds.size(), dir.c_str());
+    return 0;
+}
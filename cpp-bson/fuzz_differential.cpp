@@ -0,0 +1,105 @@
+// Canonical printer for the differential harness (fuzz_differential.sh).
+//
+//   ./fuzz_differential file...
+//
+// Prints one "<file name>\t<outcome>" line per file. The Go, Rust and
+// TypeScript implementations have the same printer (go-bson/main.go,
+// rs-bson/src/bin/canonical.rs, ts-bson/src/canonical.ts) and the harness
+// compares their lines with these. The outcome is "error <message>" or
+// "ok <value>" with the document as a value:
+//
+//   section  {<key length>:<key>=<value>;...}  keys in bytewise order
+//   array    [<value>;...]
+//   string   s<byte length>:<bytes>
+//   number   n<IEEE 754 bits of the double, 16 lowercase hex digits>
+//   bool     t or f
+//   null     z
+//
+// Numbers are compared as doubles because only this implementation keeps
+// integers apart.
+
+#include "BSONParser.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static void writeNumber(std::string& out, double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof bits);
+    char hex[17];
+    std::snprintf(hex, sizeof hex, "%016llx", static_cast<unsigned long long>(bits));
+    out += 'n';
+    out += hex;
+}
+
+static void writeCanonical(std::string& out, const BSONValue& value);
+
+static void writeCanonical(std::string& out, const BSONMap& map) {
+    // std::map orders std::string keys bytewise
+    out += '{';
+    for (const auto& member : map) {
+        out += std::to_string(member.first.size());
+        out += ':';
+        out += member.first;
+        out += '=';
+        writeCanonical(out, member.second);
+        out += ';';
+    }
+    out += '}';
+}
+
+static void writeCanonical(std::string& out, const BSONValue& value) {
+    switch (value.type) {
+        case BSONValue::STRING: {
+            const std::string& s = std::get<std::string>(value.value);
+            out += 's';
+            out += std::to_string(s.size());
+            out += ':';
+            out += s;
+            break;
+        }
+        case BSONValue::INT: writeNumber(out, std::get<int>(value.value)); break;
+        case BSONValue::FLOAT: writeNumber(out, std::get<double>(value.value)); break;
+        case BSONValue::BOOL: out += std::get<bool>(value.value) ? 't' : 'f'; break;
+        case BSONValue::NULL_TYPE: out += 'z'; break;
+        case BSONValue::ARRAY:
+            out += '[';
+            for (const BSONValue& element : std::get<BSONArray>(value.value)) {
+                writeCanonical(out, element);
+                out += ';';
+            }
+            out += ']';
+            break;
+        case BSONValue::OBJECT: writeCanonical(out, *std::get<std::shared_ptr<BSONMap>>(value.value)); break;
+    }
+}
+
+int main(int argc, char** argv) {
+    BSONParser parser;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        std::ostringstream bytes;
+        bytes << file.rdbuf();
+        std::string content = bytes.str();
+
+        BSONResult result = parser.tryParse(content);
+        std::string line;
+        if (result.ok()) {
+            line = "ok ";
+            writeCanonical(line, result.value);
+        } else {
+            line = std::string("error ") + result.error.message();
+        }
+        const char* name = std::strrchr(argv[i], '/');
+        std::printf("%s\t", name ? name + 1 : argv[i]);
+        std::fwrite(line.data(), 1, line.size(), stdout);
+        std::putchar('\n');
+    }
+    return 0;
+}
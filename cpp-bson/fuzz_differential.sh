@@ -0,0 +1,96 @@
+#!/bin/sh
+# Differential harness: parses a generated corpus (fuzz_corpus.cpp) with the
+# C++, Go, Rust and TypeScript implementations and reports every document on
+# which one of them disagrees with the C++ parser, value or error. The
+# printers share the canonical format documented in fuzz_differential.cpp.
+#
+#   cpp-bson/fuzz_differential.sh [count] [seed]
+#
+# An implementation whose toolchain is missing (go, cargo, or npx with
+# ts-bson/node_modules installed) is skipped; BSON_DIFF_IMPLS picks a subset,
+# e.g. BSON_DIFF_IMPLS="go rs". Everything is built in and written to a
+# scratch directory, BSON_DIFF_WORK if set, kept when there are differences.
+# Exits 1 if any implementation differs.
+
+set -eu
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$here")
+count=${1:-1000}
+seed=${2:-1}
+impls=${BSON_DIFF_IMPLS:-"go rs ts"}
+work=${BSON_DIFF_WORK:-$(mktemp -d "${TMPDIR:-/tmp}/bson-diff.XXXXXX")}
+CXX=${CXX:-g++}
+mkdir -p "$work"
+
+library=$(ls "$here"/*.cpp | grep -v -E '/(bench|fuzz_|main|BSONStatsAlloc)[^/]*$')
+# shellcheck disable=SC2086
+"$CXX" -std=c++17 -O2 -pthread -o "$work/cpp" "$here/fuzz_differential.cpp" $library
+"$CXX" -std=c++17 -O2 -o "$work/fuzz_corpus" "$here/fuzz_corpus.cpp"
+rm -rf "$work/corpus"
+"$work/fuzz_corpus" "$work/corpus" "$count" "$seed"
+"$work/cpp" "$work/corpus"/doc_*.bson > "$work/cpp.out"
+
+# build <impl>: builds the printer and prints the command that runs it;
+# fails with 1 if the toolchain is missing, 2 if the build fails
+build() {
+    case $1 in
+        go)
+            command -v go > /dev/null || return 1
+            (cd "$root/go-bson" && go build -o "$work/go-bson" .) >&2 || return 2
+            echo "$work/go-bson"
+            ;;
+        rs)
+            command -v cargo > /dev/null || return 1
+            cargo build --quiet --release --manifest-path "$root/rs-bson/Cargo.toml" \
+                --target-dir "$work/rust" --bin canonical >&2 || return 2
+            echo "$work/rust/release/canonical"
+            ;;
+        ts)
+            command -v npx > /dev/null && [ -d "$root/ts-bson/node_modules" ] || return 1
+            (cd "$root/ts-bson" && npx tsc --outDir "$work/ts" --module commonjs --target es2020 \
+                --moduleResolution node --strict --skipLibCheck src/canonical.ts) >&2 || return 2
+            echo "node $work/ts/canonical.js"
+            ;;
+    esac
+}
+
+# compare <impl>: prints the first differences and a count, fails on any
+compare() {
+    awk -F '\t' -v impl="$1" '
+        function cut(s) { return length(s) > 200 ? substr(s, 1, 200) "..." : s }
+        NR == FNR { cpp[$1] = $2; total++; next }
+        { seen[$1] = 1 }
+        $2 != cpp[$1] {
+            if (++bad <= 5) printf "%s differs on %s\n  cpp: %s\n  %s: %s\n", impl, $1, cut(cpp[$1]), impl, cut($2)
+        }
+        END {
+            for (name in cpp) if (!(name in seen)) missing++
+            if (missing) printf "%s: no output for %d documents\n", impl, missing
+            printf "%s: %d of %d documents differ\n", impl, bad + missing, total
+            exit (bad + missing > 0)
+        }' "$work/cpp.out" "$work/$1.out"
+}
+
+status=0
+for impl in $impls; do
+    runner=$(build "$impl") || {
+        if [ $? -eq 1 ]; then
+            echo "$impl: skipped, toolchain not found"
+        else
+            echo "$impl: build failed"
+            status=1
+        fi
+        continue
+    }
+    # shellcheck disable=SC2086
+    $runner "$work/corpus"/doc_*.bson > "$work/$impl.out" || echo "$impl: exited with status $?"
+    compare "$impl" || status=1
+done
+
+if [ $status -eq 0 ] && [ -z "${BSON_DIFF_WORK:-}" ]; then
+    rm -rf "$work"
+else
+    echo "Outputs kept in $work"
+fi
+exit $status
@@ -0,0 +1,103 @@
+// libFuzzer target for BSONParser.
+//
+// Every input goes through BSONParser::tryParse, which must not throw, and
+// through the throwing parse(), which must fail with the same message. An
+// input also fails if the parse runs over its time budget, or, in
+// BSON_STATS builds linked with BSONStatsAlloc.cpp, over its allocation or
+// memory budget. All budgets are
+// linear in the input size, so superlinear behaviour (quadratic scans,
+// buffers regrown in small steps) trips them once inputs grow; give the
+// fuzzer large seeds (see fuzz_corpus.cpp) and a large -max_len.
+//
+//   clang++ -std=c++17 -O1 -g -fsanitize=fuzzer,address -DBSON_STATS -pthread -o fuzz_parse
+//       fuzz_parse.cpp BSONStatsAlloc.cpp <the library files of the test_suite build line in the README>
+//   ./fuzz_parse -max_len=4194304 -rss_limit_mb=4096 corpus/
+//
+// Built with -DBSON_FUZZ_MAIN instead of -fsanitize=fuzzer (e.g. with g++),
+// it runs the files given on the command line through the same checks:
+//
+//   ./fuzz_parse corpus/*.bson
+//
+// BSON_FUZZ_NANOS_PER_BYTE overrides the time budget per byte (default 2000,
+// for sanitizer builds on a loaded machine).
+
+#include "BSONParser.hpp"
+#include "BSONStats.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Budgets: a fixed allowance for small inputs plus so much per input byte
+static const uint64_t kFixedNanos = 50000000; // 50 ms
+static const size_t kFixedAllocations = 4096;
+static const size_t kAllocationsPerByte = 1;
+static const size_t kFixedBytes = 1 << 20;
+static const size_t kBytesPerByte = 256;
+
+static uint64_t nanosPerByte() {
+    static const uint64_t budget = [] {
+        const char* value = std::getenv("BSON_FUZZ_NANOS_PER_BYTE");
+        return value ? std::strtoull(value, nullptr, 10) : 2000ull;
+    }();
+    return budget;
+}
+
+// over
+// Reports a blown budget; abort() makes libFuzzer keep the input.
+static void over(const char* what, uint64_t used, uint64_t budget, size_t size) {
+    std::fprintf(stderr, "BSON fuzz: %s %llu over budget %llu for a %zu-byte input\n", what,
+                 static_cast<unsigned long long>(used), static_cast<unsigned long long>(budget), size);
+    std::abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string_view content(reinterpret_cast<const char*>(data), size);
+    BSONParser parser;
+
+    uint64_t start = bsonStatsNow();
+    BSONResult result = parser.tryParse(content);
+    uint64_t nanos = bsonStatsNow() - start;
+
+    uint64_t timeBudget = kFixedNanos + nanosPerByte() * size;
+    if (nanos > timeBudget) over("parse time (ns)", nanos, timeBudget, size);
+    if (bsonStatsEnabled()) {
+        size_t allocationBudget = kFixedAllocations + kAllocationsPerByte * size;
+        size_t memoryBudget = kFixedBytes + kBytesPerByte * size;
+        if (result.stats.allocations > allocationBudget) over("allocations", result.stats.allocations, allocationBudget, size);
+        if (result.stats.peakBytes > memoryBudget) over("peak bytes", result.stats.peakBytes, memoryBudget, size);
+    }
+
+    // The throwing parse reports the same outcome
+    std::string thrown;
+    try {
+        parser.parse(std::string(content));
+    } catch (const std::runtime_error& e) {
+        thrown = e.what();
+    }
+    if (thrown != result.error.message()) {
+        std::fprintf(stderr, "BSON fuzz: tryParse said \"%s\" but parse threw \"%s\"\n", result.error.message(),
+                     thrown.c_str());
+        std::abort();
+    }
+    return 0;
+}
+
+#ifdef BSON_FUZZ_MAIN
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        std::ostringstream bytes;
+        bytes << file.rdbuf();
+        std::string input = bytes.str();
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+    std::printf("%d inputs within budget\n", argc - 1);
+    return 0;
+}
+#endif
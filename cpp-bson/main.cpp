@@ -1,4 +1,21 @@
 #include "BSONParser.hpp"
+#include "BSONArena.hpp"
+#include "BSONTape.hpp"
+#include "ThreadPool.hpp"
+#include "BSONIncremental.hpp"
+#include "BSONBinary.hpp"
+#include "BSONLazy.hpp"
+#include "BSONPath.hpp"
+#include "BSONWriter.hpp"
+#include "BSONStream.hpp"
+#include "BSONBind.hpp"
+#include "BSONEmbed.hpp"
+#include "BSONDiff.hpp"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <iostream>
 #include <cassert>
 
@@ -36,6 +53,979 @@ whitelist ~~~~> <| "Prof_Oak", "Mom" |>
     }
 }
 
+void testZeroCopyTokens() {
+    std::string input = "BULBA!\n(o) database (o)\n    host ~~~~> \"127.0.0.1\"\n";
+    Lexer lexer{std::string_view(input)};
+    const std::vector<TokenView>& tokens = lexer.tokenizeView();
+
+    const char* begin = input.data();
+    const char* end = begin + input.size();
+    for (const TokenView& t : tokens) {
+        if (t.type != TOKEN_IDENTIFIER && t.type != TOKEN_STRING) continue;
+        if (t.literal.data() < begin || t.literal.data() + t.literal.size() > end) {
+            std::cout << "Test Zero-Copy Tokens: FAIL - literal " << t.literal << " is not a view into the source" << std::endl;
+            exit(1);
+        }
+    }
+    std::cout << "Test Zero-Copy Tokens: PASS" << std::endl;
+}
+
+void testStreamingLexer() {
+    std::string input = "BULBA!\nport ~> 8080\n";
+    Lexer lexer{std::string_view(input)};
+    TokenType expected[] = {TOKEN_HEADER, TOKEN_INDENT, TOKEN_IDENTIFIER, TOKEN_VINE_WHIP, TOKEN_NUMBER, TOKEN_EOF, TOKEN_EOF};
+    for (TokenType type : expected) {
+        if (lexer.next().type != type) {
+            std::cout << "Test Streaming Lexer: FAIL - unexpected token sequence" << std::endl;
+            exit(1);
+        }
+    }
+    std::cout << "Test Streaming Lexer: PASS" << std::endl;
+}
+
+// Records the event stream as a compact string, stopping at the first "stop" key
+struct EventRecorder : BSONHandler {
+    std::string events;
+    bool onSectionOpen(std::string_view key, int level) override { events += "open:" + std::string(key) + std::to_string(level) + " "; return true; }
+    bool onSectionClose(int level) override { events += "close" + std::to_string(level) + " "; return true; }
+    bool onKey(std::string_view key) override { events += "key:" + std::string(key) + " "; return key != "stop"; }
+    bool onValue(const TokenView& value) override { events += "val:" + std::string(value.literal) + " "; return true; }
+    bool onArrayStart() override { events += "[ "; return true; }
+    bool onArrayEnd() override { events += "] "; return true; }
+};
+
+void testEventHandler() {
+    std::string input = "BULBA!\n(o) db (o)\n    (O) pool (O)\n        max ~> 100\nlist ~> <| 1, 2 |>\nstop ~> 1\nnever ~> 2\n";
+    BSONParser parser;
+    EventRecorder recorder;
+    bool finished = parser.parse(std::string_view(input), recorder);
+    std::string expected = "open:db1 open:pool2 key:max val:100 close2 close1 key:list [ val:1 val:2 ] key:stop ";
+    if (finished || recorder.events != expected) {
+        std::cout << "Test Event Handler: FAIL - got " << recorder.events << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Event Handler: PASS" << std::endl;
+}
+
+void testArenaDocument() {
+    std::string input = "BULBA!\n(o) database (o)\n    host ~~~~> \"127.0.0.1\"\n    (O) pool (O)\n        max_connections ~~~~> 100\nport ~> 1\nport ~> 2\nwhitelist ~~~~> <| \"Prof_Oak\", \"Mom\" |>\n";
+    BSONParser parser;
+    ArenaDocument doc = parser.parseArena(input);
+
+    const ArenaValue* database = doc.find("database");
+    const ArenaValue* pool = database ? database->map->find("pool") : nullptr;
+    const ArenaValue* max = pool ? pool->map->find("max_connections") : nullptr;
+    const ArenaValue* port = doc.find("port");
+    const ArenaValue* whitelist = doc.find("whitelist");
+    if (!max || max->intValue != 100 || !port || port->intValue != 2 ||
+        !whitelist || whitelist->arraySize() != 2 || whitelist->at(1).asString() != "Mom" ||
+        doc.root().size != 3) {
+        std::cout << "Test Arena Document: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Arena Document: PASS" << std::endl;
+}
+
+void testArenaHashIndex() {
+    std::string input = "BULBA!\nsmall ~> 1\n(o) big (o)\n";
+    for (int i = 0; i < 100; i++) input += "    key_" + std::to_string(i % 90) + " ~> " + std::to_string(i) + "\n";
+    BSONParser parser;
+    ArenaDocument indexed = parser.parseArena(input);
+    ArenaOptions plain;
+    plain.hashThreshold = 0;
+    ArenaDocument searched = parser.parseArena(input, plain);
+
+    const ArenaMap& big = *indexed.find("big")->map;
+    bool ok = big.indexed() && big.size == 90 && !indexed.root().indexed() && !searched.find("big")->map->indexed();
+    for (int i = 0; ok && i < 90; i++) {
+        // Duplicates resolve to the last writer in both layouts
+        std::string key = "key_" + std::to_string(i);
+        int expected = i < 10 ? i + 90 : i;
+        ok = big.find(key) && big.find(key)->intValue == expected && searched.find("big")->map->find(key)->intValue == expected;
+    }
+    if (!ok || big.find("key_90") || big.find("small")) {
+        std::cout << "Test Arena Hash Index: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Arena Hash Index: PASS" << std::endl;
+}
+
+void testTypedArrays() {
+    std::string input = "BULBA!\nints ~> <| 1, -2, 3 |>\nfloats ~> <| 0.5, 1e3 |>\nnames ~> <| \"Ash\", \"\", \"Misty\" |>\n"
+                        "mixed ~> <| 1, 2.5 |>\nnested ~> <| <| 1 |> |>\nempty ~> <||>\n";
+    BSONParser parser;
+    ArenaDocument doc = parser.parseArena(input);
+    ArenaOptions plain;
+    plain.typedArrays = false;
+    ArenaDocument untyped = parser.parseArena(input, plain);
+
+    const ArenaValue* ints = doc.find("ints");
+    const ArenaValue* floats = doc.find("floats");
+    const ArenaValue* names = doc.find("names");
+    const ArenaValue* nested = doc.find("nested");
+    bool ok = ints->intItems() && ints->intItems()[1] == -2 && ints->at(2).intValue == 3 &&
+              floats->floatItems() && floats->floatItems()[1] == 1000.0 &&
+              names->layout == ARENA_ARRAY_STRINGS && names->stringAt(1).empty() && names->at(2).asString() == "Misty" &&
+              doc.find("mixed")->layout == ARENA_ARRAY_VALUES && nested->layout == ARENA_ARRAY_VALUES &&
+              nested->at(0).intItems() && nested->at(0).intItems()[0] == 1 && doc.find("empty")->arraySize() == 0 &&
+              untyped.find("ints")->layout == ARENA_ARRAY_VALUES && untyped.find("names")->at(0).asString() == "Ash";
+    // Either layout converts back to the same tree
+    ok = ok && doc.root().toBSONMap() == parser.parse(input) && untyped.root().toBSONMap() == parser.parse(input);
+    if (!ok) {
+        std::cout << "Test Typed Arrays: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Typed Arrays: PASS" << std::endl;
+}
+
+void testParserReuse() {
+    std::string first = "BULBA!\nname ~> \"Bulbasaur\"\n(o) stats (o)\n    hp ~> 45\n    tags ~> <| 1, 2 |>\n";
+    std::string second = "BULBA!\nlevel ~> 5\nzZz ok\n";
+    std::string broken = "BULBA!\n(o) stats (o)\n        hp ~> 45\n";
+    BSONParser parser;
+    bool ok = parser.parse(first) == BSONParser().parse(first) && !parser.tryParse(broken).ok() &&
+              parser.parse(second) == BSONParser().parse(second) && parser.parse(first) == BSONParser().parse(first) &&
+              !parser.error();
+
+    // A lexer reset between inputs only returns the new tokens
+    Lexer lexer(first);
+    size_t count = lexer.tokenizeView().size();
+    lexer.reset(first);
+    ok = ok && lexer.tokenizeView().size() == count;
+    lexer.reset(second);
+    ok = ok && lexer.tokenizeView().size() == Lexer(second).tokenizeView().size();
+
+    // An arena document and builder reused across parses
+    ArenaDocument arena;
+    ArenaBuilder builder(arena);
+    for (const std::string& input : {first, second, first}) {
+        arena.reset();
+        builder.reset();
+        parser.parse(std::string_view(input), builder);
+        builder.finish();
+        ok = ok && arena.root().toBSONMap() == BSONParser().parse(input);
+    }
+    if (!ok) {
+        std::cout << "Test Parser Reuse: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Parser Reuse: PASS" << std::endl;
+}
+
+void testTapeDocument() {
+    std::string input = "BULBA!\n(o) database (o)\n    (O) pool (O)\n        max_connections ~~~~> 100\n        ratio ~> 0.5\nport ~> 1\nport ~> 2\nwhitelist ~~~~> <| \"Prof_Oak\", \"Mom\" |>\n";
+    BSONParser parser;
+    BSONTape tape = parser.parseTape(input);
+
+    TapeRef pool = tape.find("database").find("pool");
+    TapeRef whitelist = tape.find("whitelist");
+    if (!pool || pool.find("max_connections").asInt() != 100 || pool.find("ratio").asFloat() != 0.5 ||
+        tape.find("port").asInt() != 2 || whitelist.size() != 2 || whitelist[1].asString() != "Mom" ||
+        tape.find("missing")) {
+        std::cout << "Test Tape Document: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Tape Document: PASS" << std::endl;
+}
+
+void testLongDocument() {
+    // Lines of varying width push comment markers and indentation across the
+    // 64-byte blocks and 4 KiB windows of the structural index.
+    std::string input = "BULBA!\n(o) big (o)\n";
+    for (int i = 0; i < 2000; i++) {
+        input += "    key_" + std::to_string(i) + " ~> " + std::to_string(i) + std::string(i % 61, ' ') + "zZz note\n";
+    }
+    BSONParser parser;
+    try {
+        BSONMap result = parser.parse(input);
+        auto big = std::get<std::shared_ptr<BSONMap>>(result["big"].value);
+        std::shared_ptr<BSONMap> shared = parser.parseShared(input);
+        if (big->size() != 2000 || std::get<int>((*big)["key_1999"].value) != 1999 || *shared != result ||
+            shared.use_count() != 1) {
+            std::cout << "Test Long Document: FAIL - wrong contents" << std::endl;
+            exit(1);
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Test Long Document: FAIL - " << e.what() << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Long Document: PASS" << std::endl;
+}
+
+void testNumberTokens() {
+    std::string input = "BULBA!\na ~> 42\nb ~> -1.5e2\nc ~> +7\nd ~> 99999999999\n";
+    Lexer lexer{std::string_view(input)};
+    std::vector<TokenView> numbers;
+    for (TokenView t = lexer.next(); t.type != TOKEN_EOF; t = lexer.next()) {
+        if (t.type == TOKEN_NUMBER) numbers.push_back(t);
+    }
+    if (numbers.size() != 4 ||
+        numbers[0].isFloat || numbers[0].intValue != 42 ||
+        !numbers[1].isFloat || numbers[1].floatValue != -150.0 ||
+        numbers[2].isFloat || numbers[2].intValue != 7 ||
+        !numbers[3].isFloat || numbers[3].floatValue != 99999999999.0) {
+        std::cout << "Test Number Tokens: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Number Tokens: PASS" << std::endl;
+}
+
+void testArrayElements() {
+    // Commas in strings and nested arrays do not split elements; a quote
+    // only ends a string before a comma, "|>" or the end of the array
+    std::string input = "BULBA!\nlist ~> <| \"a, b\", <| 1, <| 2, 3 |> |>, \"say \"hi\"\", \"|> x\", |>\n";
+    BSONMap doc = BSONParser().parse(input);
+    const BSONArray& list = std::get<BSONArray>(doc.at("list").value);
+    bool ok = list.size() == 4 && std::get<std::string>(list[0].value) == "a, b" &&
+              list[1] == BSONValue(BSONArray{BSONValue(1), BSONValue(BSONArray{BSONValue(2), BSONValue(3)})}) &&
+              std::get<std::string>(list[2].value) == "say \"hi\"" && std::get<std::string>(list[3].value) == "|> x";
+    ok = ok && !BSONParser().tryParse("BULBA!\nlist ~> <| \"a\", b\" |>\n").ok();
+
+    // Nesting is limited to Lexer::kMaxArrayDepth levels
+    auto nested = [](int levels) {
+        std::string text = "BULBA!\nlist ~> ";
+        for (int i = 0; i < levels; i++) text += "<| 1, ";
+        text += "2";
+        for (int i = 0; i < levels; i++) text += " |>";
+        return BSONParser().tryParse(text + "\n").error.code;
+    };
+    ok = ok && nested(Lexer::kMaxArrayDepth) == BSON_OK && nested(Lexer::kMaxArrayDepth + 1) == BSON_ERR_TYPE;
+    if (!ok) {
+        std::cout << "Test Array Elements: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Array Elements: PASS" << std::endl;
+}
+
+void testParallelParse() {
+    // Enough top-level sections for several chunks; section names and root
+    // keys repeat across chunks so the merge has to keep the last writer.
+    std::string input = "BULBA!\nroot ~> 0\n";
+    for (int i = 0; i < 6000; i++) {
+        input += "(o) s" + std::to_string(i % 700) + " (o)\n";
+        input += "    a ~> " + std::to_string(i) + "\n";
+        input += "    (O) inner (O)\n        b ~> <| \"x\", " + std::to_string(i) + " |>\n";
+        if (i % 1000 == 999) input += "root ~> " + std::to_string(i) + "\n";
+    }
+    BSONParser parser;
+    ThreadPool pool(4);
+    BSONMap serial = parser.parse(input);
+    if (parser.parseParallel(input, pool) != serial || BSONParser().parseParallel(input, 2u) != serial) {
+        std::cout << "Test Parallel Parse: FAIL - result differs from the serial parse" << std::endl;
+        exit(1);
+    }
+
+    // The chunk parsers use this parser's interner and stats hooks
+    BSONKeyInterner interned(true); // Shared by the chunk parsers
+    std::atomic<size_t> closed{0};
+    int parses = 0;
+    BSONStatsHooks hooks;
+    hooks.onSection = [&](std::string_view, int, uint64_t) { closed++; };
+    hooks.onParse = [&](const BSONStats&) { parses++; };
+    BSONParser configured;
+    configured.setKeyInterner(&interned);
+    configured.setStatsHooks(hooks);
+    BSONStats serialStats = parser.tryParse(input).stats;
+    BSONResult parallel = configured.tryParseParallel(input, pool);
+    bool ok = parallel.ok() && parallel.value == serial && interned.lookup("inner") && interned.lookup("b");
+    if (bsonStatsEnabled()) {
+        ok = ok && closed == 12000 && parses == 1 && parallel.stats.sections[1] == serialStats.sections[1] &&
+             parallel.stats.sections[2] == 6000 && parallel.stats.bytes == input.size() &&
+             configured.stats().tokens[TOKEN_IDENTIFIER] == serialStats.tokens[TOKEN_IDENTIFIER] &&
+             parallel.stats.lines == serialStats.lines;
+    }
+    if (!ok) {
+        std::cout << "Test Parallel Parse: FAIL - configuration not passed to the chunk parsers" << std::endl;
+        exit(1);
+    }
+
+    // The reported error is the first one in the document, with its line
+    std::string broken = input + "(o) late (o)\n\tkey ~> 1\n";
+    broken.insert(broken.size() / 2, "\n(o) bad (o)\n    x ~> Ditto\n");
+    BSONResult expected = parser.tryParse(broken);
+    BSONResult actual = parser.tryParseParallel(broken, pool);
+    if (actual.ok() || actual.error.code != expected.error.code || actual.error.line != expected.error.line) {
+        std::cout << "Test Parallel Parse: FAIL - expected line " << expected.error.line
+                  << " but got " << actual.error.line << std::endl;
+        exit(1);
+    }
+
+    // A value missing right before a split point runs into the next chunk
+    // (the keys fill more than the smallest chunk)
+    std::string keys = "BULBA!\n";
+    for (int i = 0; i < 5000; i++) keys += "key" + std::to_string(i) + " ~> 12345678\n";
+    std::string sections;
+    for (int i = 0; i < 5000; i++) sections += "(o) s" + std::to_string(i) + " (o)\n    a ~> 1\n";
+    for (const char* next : {"", "(o) junk (o) x\n"}) {
+        std::string missing = keys + "broken ~~>\n" + next + sections;
+        expected = parser.tryParse(missing);
+        actual = parser.tryParseParallel(missing, pool);
+        if (actual.error.code != expected.error.code || actual.error.line != expected.error.line) {
+            std::cout << "Test Parallel Parse: FAIL - missing value reported on line " << actual.error.line
+                      << " instead of " << expected.error.line << std::endl;
+            exit(1);
+        }
+    }
+    std::cout << "Test Parallel Parse: PASS" << std::endl;
+}
+
+void testParseMany() {
+    // Documents of uneven size, every seventh one invalid
+    std::vector<std::string> inputs;
+    for (int i = 0; i < 300; i++) {
+        std::string doc = "BULBA!\nid ~> " + std::to_string(i) + "\n(o) body (o)\n";
+        for (int j = 0; j < i % 40; j++) doc += "    k" + std::to_string(j) + " ~> <| " + std::to_string(j) + ", \"v\" |>\n";
+        if (i % 7 == 3) doc += "    bad ~> Ditto\n";
+        inputs.push_back(doc);
+    }
+    std::vector<std::string_view> documents(inputs.begin(), inputs.end());
+    ThreadPool pool(4);
+    BSONParser parser;
+    std::vector<BSONResult> results = parser.parseMany(documents, pool);
+    std::vector<BSONMap> visited(documents.size());
+    std::vector<BSONError> errors = parser.parseMany(documents, pool, [&](size_t i, const ArenaDocument& doc) {
+        visited[i] = doc.root().toBSONMap();
+    });
+
+    bool ok = results.size() == documents.size() && errors.size() == documents.size() &&
+              BSONParser().parseMany(documents, 1u).size() == documents.size();
+    for (size_t i = 0; ok && i < documents.size(); i++) {
+        BSONResult expected = BSONParser().tryParse(documents[i]);
+        ok = results[i].error.code == expected.error.code && results[i].error.line == expected.error.line &&
+             errors[i].code == expected.error.code && results[i].value == expected.value &&
+             visited[i] == expected.value && (i % 7 == 3) != expected.ok();
+    }
+    if (!ok) {
+        std::cout << "Test Parse Many: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Parse Many: PASS" << std::endl;
+}
+
+void testStreamParser() {
+    std::string input = "BULBA!\r\nname ~> \"Bulbasaur\" zZz note\r\n(o) stats (o)\n    hp ~> 45\n"
+                        "    (O) moves (O)\n        list ~> <| 1, \"two\", 3.5 |>\nlevel ~> 5";
+    BSONMap expected = BSONParser().parse(input);
+
+    // One byte at a time: every line is split
+    BSONStreamParser bytes;
+    bool ok = true;
+    for (char c : input) ok = ok && bytes.feed(std::string_view(&c, 1));
+    ok = ok && bytes.buffered() == 10 && bytes.finish() && bytes.document() == expected;
+
+    // From a stream and from a descriptor
+    std::istringstream in(input);
+    BSONStreamParser stream;
+    ok = ok && stream.feed(in) && stream.finish() && stream.document() == expected;
+    FILE* file = std::tmpfile();
+    std::fputs(input.c_str(), file);
+    std::fflush(file);
+    std::rewind(file);
+    BSONStreamParser descriptor;
+    ok = ok && descriptor.feedFd(fileno(file)) && descriptor.finish() && descriptor.document() == expected;
+    std::fclose(file);
+
+    // Events, and errors on the same line as a whole-buffer parse
+    EventRecorder recorder;
+    BSONStreamParser events(recorder);
+    ok = ok && !events.feed("BULBA!\nstop ~> 1\n") && recorder.events == "key:stop ";
+    const char* broken[] = {"BULBA!\n(o) a (o)\n    k ~>\n\nzZz later\n    j ~> 1\n", "BULBA!\nk ~>\n\n", "BULBA!\nx ~> 1\n\tbad ~> 2\n"};
+    for (const char* doc : broken) {
+        BSONResult whole = BSONParser().tryParse(doc);
+        BSONStreamParser split;
+        std::string_view all(doc);
+        for (size_t i = 0; i < all.size(); i += 3) split.feed(all.substr(i, 3));
+        ok = ok && !split.finish() && split.error().code == whole.error.code && split.error().line == whole.error.line;
+    }
+
+    // Sections stay open across chunks the caller frees after each feed()
+    const char* chunks[] = {"BULBA!\n(o) database (o)\n    a ~> 1\n", "    b ~> 2\n(o) other (o)\n    c ~> 3\n", "d ~> 4\n"};
+    std::string closed;
+    BSONStatsHooks hooks;
+    hooks.onSection = [&](std::string_view key, int level, uint64_t) { closed += std::string(key) + std::to_string(level) + " "; };
+    BSONStreamParser freed;
+    freed.setStatsHooks(hooks);
+    for (const char* chunk : chunks) {
+        auto copy = std::make_unique<std::string>(chunk);
+        ok = ok && freed.feed(*copy);
+    }
+    ok = ok && freed.finish() && freed.document() == BSONParser().parse(std::string(chunks[0]) + chunks[1] + chunks[2]);
+    ok = ok && closed == (bsonStatsEnabled() ? "database1 other1 " : "");
+    if (!ok) {
+        std::cout << "Test Stream Parser: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Stream Parser: PASS" << std::endl;
+}
+
+void testParseFile() {
+    std::string input = "BULBA!\n(o) trainer (o)\n    name ~> \"Ash\"\n    badges ~> 8\n";
+    const char* path = "test_parse_file.bson";
+    std::ofstream(path, std::ios::binary) << input;
+    BSONParser parser;
+    try {
+        bool same = parser.parseFile(path) == parser.parse(input);
+        std::remove(path);
+        if (!same) {
+            std::cout << "Test Parse File: FAIL - result differs from parse" << std::endl;
+            exit(1);
+        }
+        parser.parseFile("does_not_exist.bson");
+        std::cout << "Test Parse File: FAIL - missing file did not throw" << std::endl;
+        exit(1);
+    } catch (const std::exception& e) {
+        if (std::string(e.what()).find("does_not_exist.bson") == std::string::npos) {
+            std::cout << "Test Parse File: FAIL - " << e.what() << std::endl;
+            exit(1);
+        }
+    }
+    std::cout << "Test Parse File: PASS" << std::endl;
+}
+
+void testIncrementalReparse() {
+    std::string input = "BULBA!\nversion ~> 1\n(o) a (o)\n    x ~> 1\n(o) b (o)\n    x ~> 2\n    (O) c (O)\n        y ~> 3\n";
+    BSONIncrementalParser incremental;
+    BSONReload first = incremental.reparse(input);
+    auto sectionA = std::get<std::shared_ptr<BSONMap>>(first.value->at("a").value);
+
+    // Change one line of section b: only that chunk is parsed again
+    std::string edited = input;
+    edited.replace(edited.find("x ~> 2"), 6, "x ~> 5");
+    BSONReload second = incremental.reparse(edited);
+    bool reused = std::get<std::shared_ptr<BSONMap>>(second.value->at("a").value) == sectionA;
+    if (!first.ok() || first.reparsedChunks != 3 || !second.ok() || second.reparsedChunks != 1 ||
+        second.reusedChunks != 2 || !reused || second.changedKeys != std::vector<std::string>{"b.x"} ||
+        *second.value != BSONParser().parse(edited) || second.value.get() != &incremental.document()) {
+        std::cout << "Test Incremental Reparse: FAIL - unexpected reload" << std::endl;
+        exit(1);
+    }
+
+    // An edit range that breaks the document keeps the previous state
+    BSONReload broken = incremental.applyEdit(edited.find("y ~> 3"), 6, "y ~> Ditto");
+    if (broken.ok() || broken.error.code != BSON_ERR_TYPE || broken.error.line != 8 ||
+        broken.value || incremental.document() != *second.value) {
+        std::cout << "Test Incremental Reparse: FAIL - bad edit was not rejected" << std::endl;
+        exit(1);
+    }
+
+    // With no reload result held, unchanged root entries move into the new
+    // document instead of being copied
+    BSONIncrementalParser owner;
+    owner.reparse("BULBA!\nname ~> \"a long root-level string, past any small-string buffer\"\n(o) a (o)\n    x ~> 1\n");
+    const std::string* name = &std::get<std::string>(owner.document().at("name").value);
+    const BSONMap* a = std::get<std::shared_ptr<BSONMap>>(owner.document().at("a").value).get();
+    BSONReload moved = owner.applyEdit(owner.source().find("x ~> 1"), 6, "x ~> 2");
+    if (!moved.ok() || moved.changedKeys != std::vector<std::string>{"a.x"} ||
+        &std::get<std::string>(moved.value->at("name").value) != name ||
+        std::get<std::shared_ptr<BSONMap>>(moved.value->at("a").value).get() == a) {
+        std::cout << "Test Incremental Reparse: FAIL - unchanged entries were copied" << std::endl;
+        exit(1);
+    }
+
+    // A value missing at the end of a chunk is reported on the next one's line
+    std::string missing = "BULBA!\n(o) a (o)\n    x ~>\n(o) b (o)\n    x ~> 2\n";
+    BSONReload cut = BSONIncrementalParser().reparse(missing);
+    BSONResult whole = BSONParser().tryParse(missing);
+    if (cut.ok() || cut.error.code != whole.error.code || cut.error.line != whole.error.line) {
+        std::cout << "Test Incremental Reparse: FAIL - missing value on line " << cut.error.line << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Incremental Reparse: PASS" << std::endl;
+}
+
+void testKeyInterner() {
+    BSONKeyInterner keys;
+    BSONParser parser;
+    parser.setKeyInterner(&keys);
+    std::string first = "BULBA!\nhost ~> \"a\"\n(o) db (o)\n    host ~> \"b\"\n    timeout_ms ~> 5\n";
+    std::string second = "BULBA!\nhost ~> \"c\"\ntimeout_ms ~> 7\n";
+    ArenaDocument a = parser.parseArena(first);
+    ArenaDocument b = parser.parseArena(second);
+
+    // Both documents point at the one interned copy of each key
+    BSONKey host = keys.lookup("host");
+    const ArenaValue* db = a.find(keys.lookup("db"));
+    bool shared = a.root().begin()[1].key.data() == b.root().begin()[0].key.data();
+    if (keys.size() != 3 || !host || !shared || !db || !db->map->find(host) ||
+        db->map->find(host)->asString() != "b" || b.find(keys.lookup("timeout_ms"))->intValue != 7 ||
+        b.find(keys.intern("missing")) != nullptr || parser.parse(first) != BSONParser().parse(first)) {
+        std::cout << "Test Key Interner: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Key Interner: PASS" << std::endl;
+}
+
+void testBinaryDocument() {
+    std::string input = R"(BULBA!
+name ~> "Bulbasaur"
+level ~> -5
+ratio ~> 0.125
+tags ~> <| "grass", 1, SuperEffective, MissingNo |>
+(o) stats (o)
+    hp ~> 45
+    (O) moves (O)
+        name ~> "Vine Whip"
+)";
+    BSONMap parsed = BSONParser().parse(input);
+    BinaryDocument doc(compileBinary(parsed, input));
+    BinaryRef moves = doc.find("stats").find("moves");
+    bool ok = doc.root().toBSONValue() == BSONValue(std::make_shared<BSONMap>(parsed)) &&
+              doc.find("name").asString() == "Bulbasaur" && doc.find("level").asInt() == -5 &&
+              doc.find("ratio").asFloat() == 0.125 && doc.find("tags")[2].asBool() &&
+              doc.find("tags")[3].type() == BSONValue::NULL_TYPE && moves.find("name").asString() == "Vine Whip" &&
+              !doc.find("missing") && doc.root().size() == 5 && doc.root().keyAt(0) == "level" &&
+              BinaryDocument::isCurrent(doc.bytes(), input) && !BinaryDocument::isCurrent(doc.bytes(), input + "x ~> 1\n");
+
+    // A stale blob on disk falls back to parsing and is rewritten
+    const char* path = "test_binary.bsonc";
+    std::string changed = input + "fresh ~> 1\n";
+    std::ofstream(path, std::ios::binary) << doc.bytes();
+    BinaryDocument current = BinaryDocument::load(path, input);
+    BinaryDocument reloaded = BinaryDocument::load(path, changed);
+    ok = ok && current.find("stats").find("hp").asInt() == 45 && reloaded.find("fresh").asInt() == 1 &&
+         BinaryDocument::isCurrent(BinaryDocument::open(path).bytes(), changed);
+    // The blob is replaced, not rewritten in place: a mapping of the old
+    // one stays readable, and no temporary file is left behind
+    BinaryDocument mapped = BinaryDocument::open(path);
+    BinaryDocument::load(path, input);
+    ok = ok && mapped.find("fresh").asInt() == 1 && BinaryDocument::isCurrent(BinaryDocument::open(path).bytes(), input);
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        ok = ok && entry.path().filename().string().rfind(std::string(path) + ".tmp", 0) != 0;
+    }
+    std::remove(path);
+    if (!ok) {
+        std::cout << "Test Binary Document: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Binary Document: PASS" << std::endl;
+}
+
+void testLazyDocument() {
+    std::string input = "BULBA!\nport ~> 8080\nbad ~> Ditto\n(o) db (o)\n    hosts ~> <| \"a\", \"b\" |>\n";
+    BSONParser parser;
+    LazyDocument doc = parser.parseLazy(input);
+    const BSONValue* port = doc.get("port");
+    const BSONValue* hosts = doc.section("db") ? doc.section("db")->get("hosts") : nullptr;
+    bool ok = port && std::get<int>(port->value) == 8080 && doc.get("port") == port && hosts &&
+              std::get<BSONArray>(hosts->value).size() == 2 && doc.get("db") == nullptr &&
+              doc.root().entry("bad")->raw == "Ditto" && !doc.root().entry("bad")->cached;
+    // Duplicates keep the last member, whether section or value
+    LazyDocument dup = parser.parseLazy("BULBA!\nb ~> 1\na ~> 2\n(o) a (o)\n    x ~> 1\nb ~> 3\nc ~> 4\n");
+    ok = ok && dup.root().size() == 3 && dup.section("a") && !dup.get("a") && std::get<int>(dup.get("b")->value) == 3;
+    ok = ok && dup.root().entries()[0].key == "a" && dup.root().entries()[2].key == "c" &&
+         dup.toBSONMap() == parser.parse("BULBA!\nb ~> 1\na ~> 2\n(o) a (o)\n    x ~> 1\nb ~> 3\nc ~> 4\n");
+    // The invalid value is only reported once it is read
+    try {
+        doc.get("bad");
+        ok = false;
+    } catch (const std::exception& e) {
+        ok = ok && std::string(e.what()) == "Target is immune!";
+    }
+    if (!ok) {
+        std::cout << "Test Lazy Document: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Lazy Document: PASS" << std::endl;
+}
+
+// Cuts the parse short as soon as a path was matched
+class PathCounter : public BSONPathMatcher {
+public:
+    using BSONPathMatcher::BSONPathMatcher;
+    bool onKey(std::string_view key) override {
+        keys++;
+        return BSONPathMatcher::onKey(key);
+    }
+    int keys = 0;
+};
+
+void testPathQuery() {
+    std::string input = R"(BULBA!
+name ~> "api"
+(o) database (o)
+    host ~> "db1"
+    (O) pool (O)
+        max_connections ~> 50
+        (@) retry (@)
+            delays ~> <| 1, 2, 4 |>
+    port ~> 5432
+(o) later (o)
+    key ~> Ditto
+)";
+    BSONPath maxConnections("database.pool.max_connections");
+    BSONPath retry("database.pool.retry");
+    BSONPath delays("database.pool.retry.delays");
+    BSONParser parser;
+    ArenaDocument arena = parser.parseArena(input.substr(0, input.find("(o) later")));
+    BSONMap tree = parser.parse(input.substr(0, input.find("(o) later")));
+
+    // The streamed parse stops before the invalid section at the end
+    PathCounter counter(retry);
+    parser.parse(input, counter);
+    std::optional<BSONValue> streamed = delays.find(input);
+    bool ok = std::get<int>(maxConnections.evaluate(tree)->value) == 50 && maxConnections.evaluate(arena)->intValue == 50 &&
+              BSONPath("database.port").evaluate(tree) && !BSONPath("database.missing").evaluate(tree) &&
+              !BSONPath("name.x").evaluate(tree) && streamed && *streamed == *delays.evaluate(tree) &&
+              std::get<int>(BSONPath("database.pool.max_connections").find(input)->value) == 50 &&
+              counter.found() && counter.keys == 4 && counter.value() == *retry.evaluate(tree) &&
+              !BSONPath("database.nope").find(input.substr(0, input.find("(o) later")));
+    try {
+        BSONPath invalid("database..pool");
+        ok = false;
+    } catch (const std::exception&) {
+    }
+    if (!ok) {
+        std::cout << "Test Path Query: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Path Query: PASS" << std::endl;
+}
+
+void testWriter() {
+    std::string input = R"(BULBA!
+name ~> "Bulbasaur"
+ratio ~> 1.0
+tiny ~> -2.5e-300
+tags ~> <| "grass", "x, y", 1, 0.1, SuperEffective, MissingNo |>
+nested ~> <| <| 1, 2 |>, <||>, "a" |>
+empty ~> <||>
+(o) stats (o)
+    hp ~> 45
+    (O) moves (O)
+        (@) first (@)
+            name ~> "Vine Whip"
+    base ~> 318
+)";
+    BSONMap parsed = BSONParser().parse(input);
+    std::string text = toBSONString(parsed);
+    BSONMap reparsed = BSONParser().parse(text);
+    bool ok = reparsed == parsed && reparsed.at("ratio").type == BSONValue::FLOAT && toBSONString(reparsed) == text;
+
+    // Buffered sinks produce the same bytes once flushed
+    FILE* file = std::tmpfile();
+    {
+        BSONWriter writer(file);
+        writer.write(parsed);
+    }
+    std::string written(text.size() + 1, '\0');
+    std::rewind(file);
+    written.resize(std::fread(&written[0], 1, written.size(), file));
+    std::fclose(file);
+    ok = ok && written == text;
+
+    // Values the format cannot express are rejected
+    auto deep = std::make_shared<BSONMap>();
+    for (int i = 0; i < 3; i++) deep = std::make_shared<BSONMap>(BSONMap{{"s", BSONValue(deep)}});
+    BSONMap invalid[] = {{{"bad key", BSONValue(1)}}, {{"Charizard", BSONValue(1)}},
+                         {{"s", BSONValue(std::string("two\nlines"))}},
+                         {{"a", BSONValue(BSONArray{BSONValue(std::string("x\", y"))})}},
+                         {{"a", BSONValue(BSONArray{BSONValue(std::make_shared<BSONMap>())})}},
+                         {{"s", BSONValue(deep)}}};
+    for (const BSONMap& map : invalid) {
+        try {
+            toBSONString(map);
+            ok = false;
+        } catch (const std::exception&) {
+        }
+    }
+    if (!ok) {
+        std::cout << "Test Writer: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Writer: PASS" << std::endl;
+}
+
+// Structs for testBinding
+struct BoundPool {
+    int max_connections = 10;
+    double timeout = 1.5;
+    std::vector<int> ports;
+    std::vector<bool> flags;
+};
+BSON_FIELDS(BoundPool, max_connections, timeout, ports, flags)
+
+struct BoundDatabase {
+    std::string host;
+    std::optional<int> replicas = 3;
+    BoundPool pool;
+};
+BSON_FIELDS(BoundDatabase, host, replicas, pool)
+
+struct BoundConfig {
+    std::string app_name;
+    bool is_production = true;
+    BoundDatabase database;
+};
+BSON_FIELDS(BoundConfig, app_name, is_production, database)
+
+void testBinding() {
+    std::string input = R"(BULBA!
+app_name ~> "Pokedex_API"
+is_production ~> NotVeryEffective
+unknown ~> <| 1, <| 2 |> |>
+(o) database (o)
+    host ~> "127.0.0.1"
+    replicas ~> MissingNo
+    (O) pool (O)
+        max_connections ~> 100
+        timeout ~> 30
+        ports ~> <| 80, 443 |>
+        flags ~> <| SuperEffective, NotVeryEffective |>
+    (O) ignored (O)
+        (@) deeper (@)
+            host ~> 5
+(o) other (o)
+    app_name ~> 1
+)";
+    BoundConfig config = bindBSON<BoundConfig>(input);
+    const BoundPool& pool = config.database.pool;
+    bool ok = config.app_name == "Pokedex_API" && !config.is_production && config.database.host == "127.0.0.1" &&
+              !config.database.replicas && pool.max_connections == 100 && pool.timeout == 30.0 &&
+              pool.ports == std::vector<int>{80, 443} && pool.flags == std::vector<bool>{true, false};
+
+    // A repeated section starts over; absent keys keep their defaults
+    BoundConfig again;
+    ok = ok && !tryBindBSON("BULBA!\n(o) database (o)\n    host ~> \"a\"\n(o) database (o)\n    replicas ~> 4\n", again) &&
+         again.database.host.empty() && again.database.replicas == 4 && again.database.pool.max_connections == 10;
+
+    // Type mismatches
+    const char* mismatched[] = {"BULBA!\napp_name ~> 5\n", "BULBA!\n(o) database (o)\n    (O) pool (O)\n        max_connections ~> 1.5\n",
+                                "BULBA!\n(o) app_name (o)\n", "BULBA!\ndatabase ~> 1\n",
+                                "BULBA!\n(o) database (o)\n    (O) pool (O)\n        ports ~> <| 1, \"x\" |>\n"};
+    int lines[] = {2, 4, 2, 2, 4};
+    for (int i = 0; i < 5; i++) {
+        BoundConfig target;
+        BSONError error = tryBindBSON(mismatched[i], target);
+        ok = ok && error.code == BSON_ERR_TYPE && error.line == lines[i];
+    }
+    ok = ok && tryBindBSON("BULBA!\n\tx ~> 1\n", again).code == BSON_ERR_TAB;
+    try {
+        bindBSON<BoundConfig>("BULBA!\nis_production ~> \"yes\"\n");
+        ok = false;
+    } catch (const std::exception& e) {
+        ok = ok && std::string(e.what()) == "Target is immune!";
+    }
+    if (!ok) {
+        std::cout << "Test Binding: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Binding: PASS" << std::endl;
+}
+
+static constexpr const char* kEmbeddedText = R"(BULBA!
+app_name ~> "Pokedex_API"
+zZz Comments and blank lines are skipped
+
+version ~> 3
+ratio ~> 0.25
+big ~> 3000000000
+precise ~> 0.1e-5
+hex ~> -0x1.8p1
+is_production ~> NotVeryEffective
+tags ~> <| "a, b", 1, , MissingNo, <| 2.5, 3 |> |>
+version ~> 4
+(o) database (o)
+    host ~> "127.0.0.1"
+    (O) pool (O)
+        max_connections ~> 100
+    port ~> 5432
+(o) database (o)
+    host ~> "db.local"
+)";
+
+static constexpr auto kEmbedded = BSON_EMBED(kEmbeddedText);
+
+// Lookups work in constant expressions too
+static_assert(kEmbedded.find("version").asInt() == 4, "last duplicate wins");
+static_assert(kEmbedded.find("database").find("host").asString() == "db.local", "later section replaces");
+static_assert(!kEmbedded.find("database").find("port"), "replaced section is gone");
+static_assert(kEmbedded.find("hex").asFloat() == -3.0 && kEmbedded.find("ratio").asFloat() == 0.25, "exact floats");
+static_assert(kEmbedded.find("tags").size() == 4 && kEmbedded.find("tags")[3][1].asInt() == 3, "arrays");
+
+void testEmbedded() {
+    BSONParser parser;
+    bool ok = kEmbedded.toBSONMap() == parser.parse(kEmbeddedText);
+    ok = ok && kEmbedded.find("big").type() == BSONValue::FLOAT && kEmbedded.find("precise").asFloat() == 0.1e-5;
+    ok = ok && kEmbedded.root().keyAt(0) == "app_name" && !kEmbedded.find("missing");
+
+    // Evaluated at run time, invalid input throws the parser's message
+    try {
+        embedBSON<4>("BULBA!\nkey ~> 1\n\tkey ~> 2");
+        ok = false;
+    } catch (const std::exception& e) {
+        ok = ok && std::string(e.what()) == "Poison Type: Tab character detected";
+    }
+    try {
+        embedBSON<4>("BULBA!\nkey ~> 0xinf");
+        ok = false;
+    } catch (const std::exception& e) {
+        ok = ok && std::string(e.what()) == "Target is immune!";
+    }
+    if (!ok) {
+        std::cout << "Test Embedded: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Embedded: PASS" << std::endl;
+}
+
+// The compile-time parser re-implements the lexer and parser, so every
+// document is run through both: same value, or the same error message
+void testEmbeddedMatchesParser() {
+    std::vector<std::string> documents = {
+        kEmbeddedText,
+        "BULBA!\nname ~> \"Bulby\"",
+        "BULBA!\nzZz only a comment\n\n",
+        "BULBA!\n(o) database (o)\n    host ~> \"127.0.0.1\"\n    (O) pool (O)\n        max ~> 100\n        (@) flags (@)\n            on ~> SuperEffective\nlist ~> <| \"a\", <| 1, 2 |>, , MissingNo |>\n",
+        "BULBA!\n(o) a (o)\n    x ~> 1\n(o) a (o)\n    y ~> 2\nx ~> 3\n",
+        "BULBA!\nkey ~~~~~~> 1\nkey2~>2\nkey3 ~>   <|  |>  \n",
+        "NOT_BULBA!\nkey ~> \"val\"",
+        "BULBA!\n\tkey ~> \"val\"",
+        "BULBA!\n key ~> \"val\"",
+        "BULBA!\nkey \"val\"",
+        "BULBA!\nCharizard ~> \"Fire\"",
+        "BULBA!\n(o) level1 (o)\n        (@) level3 (@)\n            key ~> \"val\"",
+        "BULBA!\n(O) pool (O)\n    key ~> \"val\"",
+        "BULBA!\nkey ~> UnknownType",
+        "BULBA!\n  key ~> 1\n\tkey ~> 2",
+        "BULBA!\nkey ~> \"unterminated",
+        "BULBA!\nkey ~> <| 1, 2",
+        "BULBA!\n(o) a (o)\n    x ~>\n",
+    };
+    for (const char* literal : {"42", "-7", "+7", "++7", "+-7", " 5", "2147483647", "2147483648", "-2147483648",
+                                "-2147483649", "1.5", "-1.5e2", ".5", "5.", "1e400", "1e-320", "0.1e-5", "inf",
+                                "-Infinity", "nan", "-nan", "nan(x1)", "nan()", "0x1p3", "0x.8", "-0xA",
+                                "0X1.8P1", "0x", "0x.", "0x.p1", "0xg", "0xinf", "0XINF", "-0xinf", "0xnan",
+                                "0x+1", "0x-1", "+0x1", "0x1.", "0x1p", "0x1e", "12abc", "1_000"}) {
+        documents.push_back(std::string("BULBA!\nk ~> ") + literal + "\nlist ~> <| " + literal + ", 1 |>\n");
+    }
+
+    BSONParser parser;
+    for (const std::string& document : documents) {
+        std::string parsed, embedded;
+        BSONMap expected, actual;
+        try {
+            expected = parser.parse(document);
+        } catch (const std::exception& e) {
+            parsed = e.what();
+        }
+        try {
+            if (embedBSONCount(document) > 256) throw std::logic_error("test document too large");
+            actual = embedBSON<256>(document).toBSONMap();
+        } catch (const std::exception& e) {
+            embedded = e.what();
+        }
+        // Floats diffed by bit pattern, so nan matches nan
+        bool same = parsed == embedded && diffDocuments(expected, actual).empty();
+        // Floats near the range limits are refused at compile time; the parser decides
+        same = same || (parsed.empty() && embedded.find("cannot be converted at compile time") != std::string::npos);
+        if (!same) {
+            std::cout << "Test Embedded Matches Parser: FAIL - " << document << "\n  parser: " << parsed
+                      << "\n  embedded: " << embedded << std::endl;
+            exit(1);
+        }
+    }
+    std::cout << "Test Embedded Matches Parser: PASS" << std::endl;
+}
+
+void testParseStats() {
+    std::string input = "BULBA!\nzZz tuning\n(o) db (o)\n    (O) pool (O)\n        sizes ~> <| 1, <| 2, 3 |>, 4 |>\nport ~> 8080\n";
+    BSONParser parser;
+    std::string closed;
+    int parses = 0;
+    BSONStatsHooks hooks;
+    hooks.onSection = [&](std::string_view key, int level, uint64_t) { closed += std::string(key) + std::to_string(level) + " "; };
+    hooks.onParse = [&](const BSONStats&) { parses++; };
+    parser.setStatsHooks(hooks);
+    BSONResult result = parser.tryParse(input);
+    const BSONStats& stats = result.stats;
+
+    bool ok = result.ok();
+    if (bsonStatsEnabled()) {
+        ok = ok && stats.bytes == input.size() && stats.lines == 6 && stats.tokens[TOKEN_HEADER] == 1;
+        ok = ok && stats.tokens[TOKEN_INDENT] == 4 && stats.tokens[TOKEN_NUMBER] == 5 && stats.tokens[TOKEN_COMMA] == 3;
+        ok = ok && stats.sections[1] == 1 && stats.sections[2] == 1 && stats.sections[3] == 0 && stats.maxArraySize == 3;
+        ok = ok && stats.parseNanos >= stats.lexNanos && stats.allocations > 0 && stats.peakBytes > 0;
+        ok = ok && closed == "pool2 db1 " && parses == 1 && parser.stats().lines == 6;
+        // The hooks see failed parses too
+        parser.tryParse("BULBA!\nkey ~> 1\n\tkey ~> 2");
+        ok = ok && parses == 2 && parser.stats().lines == 3;
+    } else {
+        // Compiled out: nothing is counted and the hooks never fire
+        ok = ok && stats.bytes == 0 && stats.lines == 0 && stats.allocations == 0 && closed.empty() && parses == 0;
+    }
+    if (!ok) {
+        std::cout << "Test Parse Stats: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Parse Stats: PASS" << std::endl;
+}
+
+void testDiffPatch() {
+    std::string before = "BULBA!\nport ~> 80\nold ~> 1\n(o) db (o)\n    host ~> \"a\"\n    (O) pool (O)\n        max ~> 10\n(o) logs (o)\n    level ~> 2\n";
+    std::string after = "BULBA!\nport ~> 8080\n(o) db (o)\n    host ~> \"a\"\n    (O) pool max (O)\n        max ~> 10\n    (O) pool (O)\n        max ~> 20\n        min ~> <| 1, 2 |>\n(o) logs (o)\n    level ~> 2\n";
+    BSONParser parser;
+    BSONMap oldDoc = parser.parse(before);
+    BSONMap newDoc = parser.parse(after);
+
+    // Unchanged sections ("logs") yield no ops, a new one is set whole
+    BSONPatch patch = diffDocuments(oldDoc, newDoc);
+    bool ok = patch.size() == 5 && patch[0].kind == BSONPatchOp::SET && patch[0].path == std::vector<std::string>{"db", "pool", "max"};
+    ok = ok && patch[2].path == std::vector<std::string>{"db", "pool max"} && patch[2].value.type == BSONValue::OBJECT;
+    ok = ok && patch[3].kind == BSONPatchOp::REMOVE && patch[3].path == std::vector<std::string>{"old"};
+
+    // Applying copies the sections it changes: oldDoc keeps its own
+    BSONMap patched = oldDoc;
+    applyPatch(patched, patch);
+    ok = ok && patched == newDoc && oldDoc == parser.parse(before);
+    ok = ok && std::get<std::shared_ptr<BSONMap>>(patched.at("logs").value) == std::get<std::shared_ptr<BSONMap>>(oldDoc.at("logs").value);
+
+    // Shared sections are skipped by pointer; the text form round-trips
+    ok = ok && diffDocuments(patched, newDoc).empty() && diffDocuments(oldDoc, patched).size() == 5;
+    BSONMap decoded = oldDoc;
+    applyPatch(decoded, decodePatch(encodePatch(patch)));
+    ok = ok && decoded == newDoc && encodePatch(patch).find("set 2:db 8:pool max ~> (o)\n") != std::string::npos;
+    try {
+        decodePatch("set 2:db ~> 1\nset 7:db ~> 1\n");
+        ok = false;
+    } catch (const std::exception& e) {
+        ok = ok && std::string(e.what()) == "Invalid BSON patch (line 2)";
+    }
+    // Floats compare by bit pattern, as they hash: nan is unchanged
+    std::string floats = "BULBA!\nk ~> nan\nzero ~> 0.0\nlist ~> <| nan, 1 |>\n(o) s (o)\n    k ~> nan\n";
+    BSONMap floatDoc = parser.parse(floats);
+    BSONPatch floatPatch = diffDocuments(floatDoc, parser.parse(floats));
+    BSONMap negated = parser.parse(floats);
+    negated["zero"] = BSONValue(-0.0);
+    ok = ok && floatPatch.empty() && diffDocuments(floatDoc, negated).size() == 1;
+    BSONDiffer differ;
+    ok = ok && differ.hash(std::get<std::shared_ptr<BSONMap>>(floatDoc.at("s").value)) ==
+                   differ.hash(std::get<std::shared_ptr<BSONMap>>(parser.parse(floats).at("s").value));
+
+    // Newlines inside keys count as lines
+    try {
+        decodePatch("set 3:a\nb ~> 1\nbad\n");
+        ok = false;
+    } catch (const std::exception& e) {
+        ok = ok && std::string(e.what()) == "Invalid BSON patch (line 3)";
+    }
+    if (!ok) {
+        std::cout << "Test Diff Patch: FAIL" << std::endl;
+        exit(1);
+    }
+    std::cout << "Test Diff Patch: PASS" << std::endl;
+}
+
+void testTryParse(std::string name, std::string input, BSONErrorCode code, int line) {
+    BSONParser parser;
+    BSONResult result = parser.tryParse(input);
+    if (result.error.code != code || result.error.line != line) {
+        std::cout << "Test TryParse " << name << ": FAIL - Expected code " << code << " on line " << line
+                  << " but got " << result.error.code << " on line " << result.error.line << std::endl;
+        exit(1);
+    }
+    std::cout << "Test TryParse " << name << ": PASS" << std::endl;
+}
+
 void testError(std::string name, std::string input, std::string expectedError) {
     BSONParser parser;
     try {
@@ -55,10 +1045,37 @@ void testError(std::string name, std::string input, std::string expectedError) {
 
 int main() {
     testValid();
+    testZeroCopyTokens();
+    testStreamingLexer();
+    testEventHandler();
+    testArenaDocument();
+    testArenaHashIndex();
+    testTypedArrays();
+    testParserReuse();
+    testTapeDocument();
+    testLongDocument();
+    testNumberTokens();
+    testArrayElements();
+    testParallelParse();
+    testParseMany();
+    testStreamParser();
+    testParseFile();
+    testIncrementalReparse();
+    testKeyInterner();
+    testBinaryDocument();
+    testLazyDocument();
+    testPathQuery();
+    testWriter();
+    testBinding();
+    testEmbedded();
+    testEmbeddedMatchesParser();
+    testParseStats();
+    testDiffPatch();
     
     testError("Invalid Header", "NOT_BULBA!\nkey ~> \"val\"", "Status: Fainted");
     testError("Tab Character", "BULBA!\n\tkey ~> \"val\"", "Poison Type");
     testError("Bad Indentation", "BULBA!\n key ~> \"val\"", "The attack missed!");
+    testError("Missing Vine Whip", "BULBA!\nkey \"val\"", "It hurt itself in its confusion!");
     testError("Charizard Key", "BULBA!\nCharizard ~> \"Fire\"", "It burns the bulb");
     
     // Deep Nesting Violation
@@ -67,8 +1084,25 @@ int main() {
     //             key ~> "val"
     std::string deepNesting = "BULBA!\n(o) level1 (o)\n        (@) level3 (@)\n            key ~> \"val\"";
     testError("Deep Nesting Violation", deepNesting, "Not enough badges!");
+    testError("Unindented Stage 2 Section", "BULBA!\n(O) pool (O)\n    key ~> \"val\"", "The attack missed!");
     
     testError("Invalid Type", "BULBA!\nkey ~> UnknownType", "Target is immune!");
+    testError("Trailing Garbage Number", "BULBA!\nkey ~> 12abc", "Target is immune!");
+    // "0x" is only a hex float with a hex digit after it, as for strtod
+    for (std::string literal : {"0xinf", "0XINF", "-0xinf", "0xnan", "0x.p1"}) {
+        testError("Hex Prefix " + literal, "BULBA!\nkey ~> " + literal, "Target is immune!");
+    }
+    // Errors surface in line order: the bad indent is reported before the tab below it is lexed
+    testError("First Error Wins", "BULBA!\n  key ~> 1\n\tkey ~> 2", "The attack missed!");
+
+    testTryParse("Valid", "BULBA!\nkey ~> 1\n", BSON_OK, 0);
+    testTryParse("Header", "NOT_BULBA!\nkey ~> 1", BSON_ERR_HEADER, 1);
+    testTryParse("Tab", "BULBA!\nkey ~> 1\n\tkey ~> 2", BSON_ERR_TAB, 3);
+    testTryParse("Indentation", "BULBA!\n(o) s (o)\n    a ~> 1\n      b ~> 2", BSON_ERR_INDENTATION, 4);
+    testTryParse("Syntax", "BULBA!\nkey ~> 1\nkey \"val\"", BSON_ERR_SYNTAX, 3);
+    testTryParse("Type", "BULBA!\nkey ~> [1, Ditto]", BSON_ERR_TYPE, 2);
+    testTryParse("Badges", deepNesting, BSON_ERR_BADGES, 3);
+    testTryParse("Charizard", "BULBA!\n(o) Charizard (o)", BSON_ERR_CHARIZARD, 2);
 
     return 0;
 }
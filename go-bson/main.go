@@ -0,0 +1,79 @@
+package main
+
+import (
+	"fmt"
+	"math"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+)
+
+// main prints the canonical form of each BSON file given on the command
+// line, one "<file name>\t<outcome>" line per file, for the differential
+// harness (cpp-bson/fuzz_differential.sh). The format is documented in
+// cpp-bson/fuzz_differential.cpp.
+func main() {
+	for _, path := range os.Args[1:] {
+		content, err := os.ReadFile(path)
+		if err != nil {
+			fmt.Fprintln(os.Stderr, err)
+			os.Exit(1)
+		}
+		fmt.Printf("%s\t%s\n", filepath.Base(path), canonical(string(content)))
+	}
+}
+
+// canonical parses content and formats the outcome
+func canonical(content string) string {
+	data, err := Parse(content)
+	if err != nil {
+		return "error " + err.Error()
+	}
+	var b strings.Builder
+	b.WriteString("ok ")
+	writeCanonical(&b, data)
+	return b.String()
+}
+
+func writeCanonical(b *strings.Builder, value interface{}) {
+	switch v := value.(type) {
+	case map[string]interface{}:
+		keys := make([]string, 0, len(v))
+		for key := range v {
+			keys = append(keys, key)
+		}
+		// Go compares strings bytewise
+		sort.Strings(keys)
+		b.WriteByte('{')
+		for _, key := range keys {
+			fmt.Fprintf(b, "%d:%s=", len(key), key)
+			writeCanonical(b, v[key])
+			b.WriteByte(';')
+		}
+		b.WriteByte('}')
+	case []interface{}:
+		b.WriteByte('[')
+		for _, element := range v {
+			writeCanonical(b, element)
+			b.WriteByte(';')
+		}
+		b.WriteByte(']')
+	case string:
+		fmt.Fprintf(b, "s%d:%s", len(v), v)
+	case int:
+		fmt.Fprintf(b, "n%016x", math.Float64bits(float64(v)))
+	case float64:
+		fmt.Fprintf(b, "n%016x", math.Float64bits(v))
+	case bool:
+		if v {
+			b.WriteByte('t')
+		} else {
+			b.WriteByte('f')
+		}
+	case nil:
+		b.WriteByte('z')
+	default:
+		fmt.Fprintf(b, "?%T", v)
+	}
+}
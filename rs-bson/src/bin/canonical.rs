@@ -0,0 +1,70 @@
+// Prints the canonical form of each BSON file given on the command line, one
+// "<file name>\t<outcome>" line per file, for the differential harness
+// (cpp-bson/fuzz_differential.sh). The format is documented in
+// cpp-bson/fuzz_differential.cpp.
+
+use std::env;
+use std::fmt::Write;
+use std::fs::File;
+use std::path::Path;
+use std::process;
+
+use rs_bson::lexer;
+use rs_bson::parser::{self, BsonValue};
+
+fn main() {
+    for arg in env::args().skip(1) {
+        let path = Path::new(&arg);
+        let file = match File::open(path) {
+            Ok(file) => file,
+            Err(e) => {
+                eprintln!("Cannot open {}: {}", arg, e);
+                process::exit(1);
+            }
+        };
+        let name = path.file_name().map_or(arg.clone(), |name| name.to_string_lossy().into_owned());
+        println!("{}\t{}", name, canonical(file));
+    }
+}
+
+fn canonical(file: File) -> String {
+    let tokens = match lexer::lex(file) {
+        Ok(tokens) => tokens,
+        Err(e) => return format!("error {}", e),
+    };
+    match parser::parse(&tokens) {
+        Ok(value) => {
+            let mut out = String::from("ok ");
+            write_canonical(&value, &mut out);
+            out
+        }
+        Err(e) => format!("error {}", e),
+    }
+}
+
+fn write_canonical(value: &BsonValue, out: &mut String) {
+    match value {
+        // BTreeMap<&str, _> iterates in bytewise key order
+        BsonValue::Map(map) => {
+            out.push('{');
+            for (key, member) in map {
+                write!(out, "{}:{}=", key.len(), key).unwrap();
+                write_canonical(&member.borrow(), out);
+                out.push(';');
+            }
+            out.push('}');
+        }
+        BsonValue::Array(elements) => {
+            out.push('[');
+            for element in elements {
+                write_canonical(&element.borrow(), out);
+                out.push(';');
+            }
+            out.push(']');
+        }
+        BsonValue::BString(s) => write!(out, "s{}:{}", s.len(), s).unwrap(),
+        BsonValue::Number(n) => write!(out, "n{:016x}", n.to_bits()).unwrap(),
+        BsonValue::Bool(b) => out.push(if *b { 't' } else { 'f' }),
+        BsonValue::Null(()) => out.push('z'),
+    }
+}
@@ -0,0 +1,53 @@
+/// <reference types="node" />
+import { readFileSync } from "fs";
+import { basename } from "path";
+import { parse } from "./parser";
+import type { BSONValue } from "./parser";
+
+// Canonical printer for the differential harness (cpp-bson/fuzz_differential.sh)
+// Prints one "<file name>\t<outcome>" line per file given on the command line.
+// The format is documented in cpp-bson/fuzz_differential.cpp.
+
+// Keys in bytewise (UTF-8) order, as the other implementations sort them
+const byteOrder = (a: string, b: string): number =>
+  Buffer.compare(Buffer.from(a), Buffer.from(b));
+
+const numberBits = (value: number): string => {
+  const view = new DataView(new ArrayBuffer(8));
+  view.setFloat64(0, value);
+  return view.getBigUint64(0).toString(16).padStart(16, "0");
+};
+
+const writeCanonical = (value: BSONValue): string => {
+  if (value === null) return "z";
+  if (Array.isArray(value)) {
+    return `[${value.map((element) => `${writeCanonical(element)};`).join("")}]`;
+  }
+  switch (typeof value) {
+    case "string":
+      return `s${Buffer.byteLength(value)}:${value}`;
+    case "number":
+      return `n${numberBits(value)}`;
+    case "boolean":
+      return value ? "t" : "f";
+    default: {
+      const members = Object.keys(value)
+        .sort(byteOrder)
+        .map((key) => `${Buffer.byteLength(key)}:${key}=${writeCanonical(value[key] as BSONValue)};`);
+      return `{${members.join("")}}`;
+    }
+  }
+};
+
+const canonical = (content: string): string => {
+  try {
+    return `ok ${writeCanonical(parse(content))}`;
+  } catch (e) {
+    return `error ${(e as Error).message}`;
+  }
+};
+
+process.argv.slice(2).forEach((path) => {
+  const content = readFileSync(path, "utf8");
+  process.stdout.write(`${basename(path)}\t${canonical(content)}\n`);
+});
@@ -84,6 +84,13 @@ Charizard ~> "Fire"`;
     expect(() => parse(input)).toThrow("Not enough badges!");
   });
 
+  test('Unindented Stage 2 Section', () => {
+    const input = `BULBA!
+(O) pool (O)
+    key ~> "val"`;
+    expect(() => parse(input)).toThrow("The attack missed!");
+  });
+
   test('Invalid Type', () => {
     const input = `BULBA!
 key ~> UnknownType`;
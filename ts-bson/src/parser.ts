@@ -128,8 +128,10 @@ const parseStatement = (cursor: Cursor, currentLevel: number): [string, BSONValu
     const headerLevel = nextToken.level;
 
     // Hierarchy Check: Evolution must be sequential (1 -> 2 -> 3)
+    // The indent is the current level here, so a marker of another level is
+    // indented wrong for it (a missing parent is caught in parseBlock)
     if (headerLevel !== currentLevel + 1) {
-      throw new Error(ERR_BADGES);
+      throw new Error(ERR_INDENTATION);
     }
 
     // Consume INDENT, SECTION_OPEN